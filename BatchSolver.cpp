@@ -0,0 +1,170 @@
+#include "BatchSolver.h"
+
+////////////////////////////////////////////////////////////////////////////////
+
+// pack and unpack a [begin, end) range
+static unsigned long long packRange(unsigned int begin, unsigned int end) {
+	return ((unsigned long long)begin << 32) | end;
+}
+
+static unsigned int rangeBegin(unsigned long long range) {
+	return (unsigned int)(range >> 32);
+}
+
+static unsigned int rangeEnd(unsigned long long range) {
+	return (unsigned int)(range & 0xffffffffu);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BatchSolver::BatchSolver(int threadCount) :
+	generation(0), running(0), quit(false),
+	chains(0), targets(0), results(0), budget(0), maxIterations(0)
+{
+	// one thread per core by default, the caller counts as one of them
+	if (threadCount <= 0) {
+		threadCount = glm::max((int)std::thread::hardware_concurrency(), 1);
+	}
+
+	ranges.reset(new std::atomic<unsigned long long>[threadCount]);
+	for (int i = 0; i < threadCount; ++i) {
+		ranges[i].store(packRange(0, 0));
+	}
+	for (int i = 1; i < threadCount; ++i) {
+		threads.push_back(std::thread(&BatchSolver::run, this, i));
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BatchSolver::~BatchSolver()
+{
+	// wake the threads up and wait for them to leave
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		quit = true;
+	}
+	start.notify_all();
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+std::vector<SolveResult> BatchSolver::solve(const std::vector<Chain*>& chains,
+	const std::vector<glm::vec3>& targets, long long budget, int maxIterations)
+{
+	size_t count = glm::min(chains.size(), targets.size());
+	std::vector<SolveResult> results(count);
+	if (count == 0) {
+		return results;
+	}
+
+	// split the chains evenly, stealing takes care of the imbalance
+	int threadCount = getThreadCount();
+	for (int i = 0; i < threadCount; ++i) {
+		unsigned int begin = (unsigned int)(count * i / threadCount);
+		unsigned int end = (unsigned int)(count * (i + 1) / threadCount);
+		ranges[i].store(packRange(begin, end));
+	}
+
+	// publish the batch and start the threads
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		this->chains = chains.data();
+		this->targets = targets.data();
+		this->results = results.data();
+		this->budget = budget;
+		this->maxIterations = maxIterations;
+		running = threadCount;
+		++generation;
+	}
+	start.notify_all();
+
+	// work alongside the pool, then wait for the others to finish
+	work(0);
+	std::unique_lock<std::mutex> lock(mutex);
+	done.wait(lock, [this] { return running == 0; });
+	return results;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void BatchSolver::run(int worker)
+{
+	int seen = 0;
+	while (true) {
+		// wait for the next batch
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			start.wait(lock, [this, seen] { return quit || generation != seen; });
+			if (quit) {
+				return;
+			}
+			seen = generation;
+		}
+
+		work(worker);
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void BatchSolver::work(int worker)
+{
+	// solve chains until there is nothing left to take or steal
+	int index;
+	while (next(worker, index)) {
+		results[index] = chains[index]->solve(targets[index], budget, maxIterations);
+	}
+
+	// the last thread out wakes up the caller
+	std::lock_guard<std::mutex> lock(mutex);
+	if (--running == 0) {
+		done.notify_all();
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool BatchSolver::next(int worker, int& index)
+{
+	int threadCount = getThreadCount();
+	while (true) {
+		// take the front of our own range
+		unsigned long long range = ranges[worker].load();
+		unsigned int begin = rangeBegin(range);
+		unsigned int end = rangeEnd(range);
+		if (begin < end) {
+			if (ranges[worker].compare_exchange_weak(range, packRange(begin + 1, end))) {
+				index = (int)begin;
+				return true;
+			}
+			continue;
+		}
+
+		// steal the back half of the first range that still has work
+		bool stolen = false;
+		for (int i = 1; i < threadCount && !stolen; ++i) {
+			int victim = (worker + i) % threadCount;
+			unsigned long long theirs = ranges[victim].load();
+			while (rangeBegin(theirs) < rangeEnd(theirs)) {
+				unsigned int b = rangeBegin(theirs);
+				unsigned int e = rangeEnd(theirs);
+				unsigned int middle = b + (e - b) / 2;
+				if (ranges[victim].compare_exchange_weak(theirs, packRange(b, middle))) {
+					// nobody can change our range while it is empty, so a plain store is enough
+					ranges[worker].store(packRange(middle, e));
+					stolen = true;
+					break;
+				}
+			}
+		}
+		if (!stolen) {
+			return false;
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
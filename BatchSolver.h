@@ -0,0 +1,65 @@
+#ifndef _BATCHSOLVER_H_
+#define _BATCHSOLVER_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include "ikcore.h"
+#include "Chain.h"
+
+////////////////////////////////////////////////////////////////////////////////
+
+// The BatchSolver solves many independent chains in parallel on a pool of
+// threads that lives as long as the solver. Each batch is split into one
+// range of chains per thread. A thread works through its own range from the
+// front, and once it runs dry it steals the back half of another thread's
+// range, so chains that take longer to converge do not leave threads idle.
+// The calling thread takes part in the work.
+
+class BatchSolver
+{
+private:
+	std::vector<std::thread> threads;
+	std::mutex mutex;
+	std::condition_variable start;
+	std::condition_variable done;
+	int generation;		// incremented for every batch
+	int running;		// threads still working on the batch
+	bool quit;
+
+	// current batch
+	Chain* const* chains;
+	const glm::vec3* targets;
+	SolveResult* results;
+	long long budget;
+	int maxIterations;
+
+	// [begin, end) range of chains left for each thread, packed in 64 bits so
+	// the owner and thieves can update it with a single compare and swap
+	std::unique_ptr<std::atomic<unsigned long long>[]> ranges;
+
+	void run(int worker);
+	void work(int worker);
+	bool next(int worker, int& index);
+
+public:
+	BatchSolver(int threadCount = 0);
+	~BatchSolver();
+
+	BatchSolver(const BatchSolver&) = delete;
+	BatchSolver& operator=(const BatchSolver&) = delete;
+
+	// Solve chains[i] toward targets[i] with Chain::solve. The chains must be
+	// distinct. budget and maxIterations apply to each chain separately.
+	std::vector<SolveResult> solve(const std::vector<Chain*>& chains,
+		const std::vector<glm::vec3>& targets, long long budget,
+		int maxIterations = INT_MAX);
+
+	int getThreadCount()			{return (int)threads.size() + 1;}
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif
@@ -1,8 +1,42 @@
 #include "Chain.h"
+#include "Cholesky.h"
+#include "SolverLoop.h"
+#include "TraceWriter.h"
+
+// Axis times angle of a rotation matrix
+static glm::vec3 getRotationVector(const glm::mat3& rotation) {
+      float cosine = glm::clamp((rotation[0][0] + rotation[1][1] + rotation[2][2] - 1) * 0.5f, -1.0f, 1.0f);
+      float angle = acos(cosine);
+      // the antisymmetric part is 2 sin(angle) times the axis
+      glm::vec3 axis(rotation[1][2] - rotation[2][1], rotation[2][0] - rotation[0][2],
+            rotation[0][1] - rotation[1][0]);
+      float sine = 0.5f * glm::length(axis);
+      if (sine > 1e-4f) {
+            return axis * (angle / (2 * sine));
+      }
+      if (cosine > 0) {
+            return 0.5f * axis;
+      }
+      // close to a half turn, the axis is the largest column of R + I
+      glm::mat3 symmetric = rotation + glm::mat3(1);
+      axis = symmetric[0];
+      for (int i = 1; i < 3; ++i) {
+            if (glm::length(symmetric[i]) > glm::length(axis)) {
+                  axis = symmetric[i];
+            }
+      }
+      return glm::normalize(axis) * angle;
+}
 
 Chain::Chain(int count, glm::vec3 offset) {
       // model matrix
-      model = glm::translate(glm::mat4(1), offset) * glm::mat4(1);
+      model = Transform(glm::mat3(1), offset);
+
+      // default solver
+      solver = JACOBIAN_TRANSPOSE;
+      damping = 1.0f;
+      reachability = 0;
+      telemetry = 0;
 
       // bounding box value
       auto boxMin = glm::vec3(-0.1, 0, -0.1);
@@ -13,49 +47,448 @@ Chain::Chain(int count, glm::vec3 offset) {
       auto noLimit = glm::vec2(-100000, 100000);
       
       // root joint, with limit on x axis and z axis
-      root = new Joint(1, glm::vec3(0), glm::vec3(0),
+      skeleton.addJoint(-1, 1, glm::vec3(0), glm::vec3(0),
             glm::vec2(fixed), glm::vec2(fixed), glm::vec2(noLimit));
-      joints.push_back(root);
 
-      // record previous joint to build the chain
-      Joint* prevJoint = root;
-      // create child joint one by one, connected together into a chain
+      // create child joint one by one, each one the child of the previous one
       for (int i = 1; i < count; ++i) {
             // intermediate joint with no limit
-            Joint* joint = new Joint(1, glm::vec3(0), glm::vec3(0, 1, 0),
+            skeleton.addJoint(i - 1, 1, glm::vec3(0), glm::vec3(0, 1, 0),
                   glm::vec2(noLimit), glm::vec2(noLimit), glm::vec2(noLimit));
-            prevJoint->addChild(joint);
-            joints.push_back(joint);
-            prevJoint = joint;
+      }
+
+      // handles to the joints for code outside the solvers
+      for (int i = 0; i < skeleton.size(); ++i) {
+            joints.push_back(new Joint(&skeleton, i));
       }
 }
 
-Chain::~Chain() {
-      // delete from root, joint delete handle child deletion
-      delete root;
+Chain::Chain(const Skeleton& skeleton, glm::vec3 offset) :
+      skeleton(skeleton), model(glm::mat3(1), offset), solver(JACOBIAN_TRANSPOSE),
+      damping(1.0f), reachability(0), telemetry(0) {
+      // handles to the joints for code outside the solvers
+      for (int i = 0; i < this->skeleton.size(); ++i) {
+            joints.push_back(new Joint(&this->skeleton, i));
+      }
 }
 
-void Chain::draw(const glm::mat4& viewProjMtx, GLuint shader) {
-      root->draw(viewProjMtx, shader);
+Chain::~Chain() {
+      // delete the handles, the joint data goes with the skeleton
+      for (Joint* joint : joints) {
+            delete joint;
+      }
 }
 
 void Chain::update() {
-      root->update(model);
+      TraceSpan span("forward kinematics", "solver");
+      skeleton.update(model);
 }
 
 // Do inverse kinematics to move the chain toward the target
 void Chain::moveToward(glm::vec3 target) {
+      switch (solver) {
+      case DAMPED_LEAST_SQUARES:
+            dampedLeastSquares(target);
+            break;
+      case CYCLIC_COORDINATE_DESCENT:
+            cyclicCoordinateDescent(target);
+            break;
+      case FABRIK:
+            fabrik(target);
+            break;
+      default:
+            jacobianTranspose(target);
+            break;
+      }
+}
+
+// Iterate the solver until the chain reaches the target, see iterateSolver.
+// With a reachability map, a target beyond the reach of the chain is pulled
+// onto it, and a target out of reach stops the solver once it no longer gets
+// closer instead of using up the budget.
+SolveResult Chain::solve(glm::vec3 target, long long budget, int maxIterations) {
+      bool reachable = isReachable(target);
+      glm::vec3 goal = getReachableTarget(target);
+      long long clamps = skeleton.getClampCount();
+      SolveResult result = iterateSolver(skeleton, bestPose, telemetry, budget,
+            maxIterations, &goal.x, 3, target, !reachable,
+            [&]() { update(); },
+            [&]() { moveToward(goal); },
+            [&]() { return getResidual(goal) / TOLERANCE; });
+
+      result.residual = getResidual(target);
+      result.angle = 0;
+      result.converged = result.residual <= TOLERANCE;
+      result.reachable = reachable || result.converged;
+      // a call that took no step has nothing to add
+      if (telemetry && result.iterations > 0) {
+            telemetry->endSolve(result.iterations, getResidual(goal) / TOLERANCE,
+                  result.elapsed, (int)(skeleton.getClampCount() - clamps),
+                  result.converged, result.reachable);
+      }
+      return result;
+}
+
+// Iterate toward a position and orientation. Whatever the solver mode, this
+// uses the damped least-squares method, with the orientation error as 3 more
+// rows of the system.
+SolveResult Chain::solve(const PoseTarget& target, long long budget, int maxIterations) {
+      bool reachable = isReachable(target.position);
+      PoseTarget goal = target;
+      goal.position = getReachableTarget(target.position);
+      long long clamps = skeleton.getClampCount();
+      float key[14] = {goal.position.x, goal.position.y, goal.position.z,
+            goal.positionWeight, goal.orientationWeight};
+      for (int i = 0; i < 9; ++i) {
+            key[5 + i] = goal.orientation[i / 3][i % 3];
+      }
+      SolveResult result = iterateSolver(skeleton, bestPose, telemetry, budget,
+            maxIterations, key, 14, target.position, !reachable,
+            [&]() { update(); },
+            [&]() { dampedLeastSquares(goal); },
+            [&]() { return getPoseError(goal); });
+
+      result.residual = getResidual(target.position);
+      result.angle = getAngle(target.orientation);
+      result.converged = (target.positionWeight <= 0 || result.residual <= TOLERANCE)
+            && (target.orientationWeight <= 0 || result.angle <= ANGLE_TOLERANCE);
+      result.reachable = reachable || result.converged;
+      if (telemetry && result.iterations > 0) {
+            telemetry->endSolve(result.iterations, getPoseError(goal),
+                  result.elapsed, (int)(skeleton.getClampCount() - clamps),
+                  result.converged, result.reachable);
+      }
+      return result;
+}
+
+// Distance from the end of the chain to the target
+float Chain::getResidual(glm::vec3 target) {
+      return glm::length(target - skeleton.getEndLocation(skeleton.size() - 1));
+}
+
+// Angle between the orientation of the last joint and the given one
+float Chain::getAngle(const glm::mat3& orientation) {
+      const glm::mat3& current = skeleton.worlds[skeleton.size() - 1].rotation;
+      return glm::length(getRotationVector(orientation * glm::transpose(current)));
+}
+
+// Error of a pose target relative to the tolerances, at most 1 once every
+// weighted part is within its tolerance
+float Chain::getPoseError(const PoseTarget& target) {
+      float error = 0;
+      if (target.positionWeight > 0) {
+            error = getResidual(target.position) / TOLERANCE;
+      }
+      if (target.orientationWeight > 0) {
+            error = glm::max(error, getAngle(target.orientation) / ANGLE_TOLERANCE);
+      }
+      return error;
+}
+
+// Whether the reachability map leaves the target in reach
+bool Chain::isReachable(glm::vec3 target) {
+      return !reachability || reachability->isReachable(model.inverse().transformPoint(target));
+}
+
+// The target itself, or its projection onto the ball the chain can reach if
+// it lies beyond, see ReachabilityMap::getNearestReachable
+glm::vec3 Chain::getReachableTarget(glm::vec3 target) {
+      if (!reachability) {
+            return target;
+      }
+      glm::vec3 local = model.inverse().transformPoint(target);
+      return model.transformPoint(reachability->getNearestReachable(local));
+}
+
+// Fill the jacobian in a single pass over the skeleton's world matrices. The
+// columns are the x, y and z axes of each joint crossed with the vector from
+// the joint to the point, the same as Joint::jacobianX/Y/Z. Returns the end
+// location of the chain, which comes out of the same pass.
+glm::vec3 Chain::computeJacobian(glm::vec3 point) {
+      TraceSpan span("jacobian", "solver");
+      int count = skeleton.size();
+      jacobian.resize(3 * count);
+      for (int i = 0; i < count; ++i) {
+            const Transform& world = skeleton.worlds[i];
+            glm::vec3 difference = point - world.translation;
+            jacobian[3 * i] = glm::cross(world.rotation[0], difference);
+            jacobian[3 * i + 1] = glm::cross(world.rotation[1], difference);
+            jacobian[3 * i + 2] = glm::cross(world.rotation[2], difference);
+      }
+
+      // end of the last joint
+      return skeleton.getEndLocation(count - 1);
+}
+
+// Position and orientation rows of the jacobian at a point, with the world
+// axes of the Euler rotations (Skeleton::getAxisX/Y/Z), which the orientation
+// rows need to be exact
+void Chain::computePoseJacobian(glm::vec3 point) {
+      TraceSpan span("jacobian", "solver");
+      int count = skeleton.size();
+      jacobian.resize(3 * count);
+      angularJacobian.resize(3 * count);
+      for (int i = 0; i < count; ++i) {
+            glm::vec3 difference = point - skeleton.getJointLocation(i);
+            angularJacobian[3 * i] = skeleton.getAxisX(i);
+            angularJacobian[3 * i + 1] = skeleton.getAxisY(i);
+            angularJacobian[3 * i + 2] = skeleton.getAxisZ(i);
+            for (int k = 0; k < 3; ++k) {
+                  jacobian[3 * i + k] = glm::cross(angularJacobian[3 * i + k], difference);
+            }
+      }
+}
+
+// One step of the Jacobian transpose method
+void Chain::jacobianTranspose(glm::vec3 target) {
       // difference between the target and the end of the chain
-      glm::vec3 difference = target - joints[joints.size() - 1]->getEndLocation();
+      glm::vec3 difference = target - computeJacobian(target);
       // if not close enough
-      if (glm::length(difference) > 0.01) {
-            // calculate jacobian for each joint and calculate the angle they should move
-            for (auto joint : joints) {
-                  float deltaX = 0.001 * glm::dot(joint->jacobianX(target), difference);
-                  float deltaY = 0.001 * glm::dot(joint->jacobianY(target), difference);
-                  float deltaZ = 0.001 * glm::dot(joint->jacobianZ(target), difference);
+      if (glm::length(difference) > TOLERANCE) {
+            // calculate the angle each joint should move
+            for (int i = 0; i < skeleton.size(); ++i) {
+                  float deltaX = 0.001 * glm::dot(jacobian[3 * i], difference);
+                  float deltaY = 0.001 * glm::dot(jacobian[3 * i + 1], difference);
+                  float deltaZ = 0.001 * glm::dot(jacobian[3 * i + 2], difference);
                   // increment pose to move toward the target
-                  joint->incrementPose(glm::vec3(deltaX, deltaY, deltaZ));
+                  skeleton.setPose(i, skeleton.poses[i] + glm::vec3(deltaX, deltaY, deltaZ));
+            }
+      }
+}
+
+// One Levenberg-Marquardt step of the damped least-squares method.
+// The step is J^T (J J^T + damping^2 I)^-1 e. If it brings the end closer to
+// the target the damping is relaxed, otherwise the pose is restored and the
+// step retried with more damping.
+void Chain::dampedLeastSquares(glm::vec3 target) {
+      int count = skeleton.size();
+      glm::vec3 end = skeleton.getEndLocation(count - 1);
+      glm::vec3 difference = target - end;
+      float error = glm::length(difference);
+      // if close enough
+      if (error <= TOLERANCE) {
+            return;
+      }
+
+      // jacobian at the end of the chain, and J J^T accumulated from it
+      computeJacobian(end);
+      glm::mat3 jjt(0);
+      for (int i = 0; i < 3 * count; ++i) {
+            jjt += glm::outerProduct(jacobian[i], jacobian[i]);
+      }
+      savedPose = skeleton.poses;
+
+      for (int retry = 0; retry < MAX_DAMPING_RETRIES; ++retry) {
+            // solve the damped 3x3 system, then map back through J^T
+            glm::vec3 f = glm::inverse(jjt + glm::mat3(damping * damping)) * difference;
+            for (int i = 0; i < count; ++i) {
+                  skeleton.setPose(i, skeleton.poses[i] + glm::vec3(
+                        glm::dot(jacobian[3 * i], f),
+                        glm::dot(jacobian[3 * i + 1], f),
+                        glm::dot(jacobian[3 * i + 2], f)));
+            }
+            update();
+
+            // accept the step and trust the linearization more next time
+            float newError = glm::length(target - skeleton.getEndLocation(count - 1));
+            if (newError < error) {
+                  damping = glm::max(damping * 0.5f, MIN_DAMPING);
+                  return;
+            }
+
+            // reject the step and damp harder
+            for (int i = 0; i < count; ++i) {
+                  skeleton.setPose(i, savedPose[i]);
+            }
+            update();
+            damping = glm::min(damping * 4.0f, MAX_DAMPING);
+      }
+}
+
+// Damped least-squares step toward a position and orientation, the 6 row
+// version of the step above. The position and orientation rows and errors
+// are scaled by their weights.
+void Chain::dampedLeastSquares(const PoseTarget& target) {
+      // if close enough
+      if (getPoseError(target) <= 1) {
+            return;
+      }
+
+      int count = skeleton.size();
+      glm::vec3 end = skeleton.getEndLocation(count - 1);
+      float wp = target.positionWeight;
+      float wo = target.orientationWeight;
+      glm::vec3 difference = wp * (target.position - end);
+      glm::vec3 rotation = wo * getRotationVector(target.orientation
+            * glm::transpose(skeleton.worlds[count - 1].rotation));
+      float error = glm::dot(difference, difference) + glm::dot(rotation, rotation);
+
+      // J J^T, 6 x 6, accumulated column by column
+      computePoseJacobian(end);
+      float jjt[6][6] = {};
+      for (int i = 0; i < 3 * count; ++i) {
+            float column[6];
+            for (int k = 0; k < 3; ++k) {
+                  column[k] = wp * jacobian[i][k];
+                  column[3 + k] = wo * angularJacobian[i][k];
+            }
+            for (int row = 0; row < 6; ++row) {
+                  for (int col = 0; col < 6; ++col) {
+                        jjt[row][col] += column[row] * column[col];
+                  }
             }
       }
-}
\ No newline at end of file
+      savedPose = skeleton.poses;
+
+      for (int retry = 0; retry < MAX_DAMPING_RETRIES; ++retry) {
+            // solve the damped 6x6 system, then map back through J^T
+            system.resize(36);
+            for (int row = 0; row < 6; ++row) {
+                  for (int col = 0; col < 6; ++col) {
+                        system[row * 6 + col] = jjt[row][col] + (row == col ? damping * damping : 0);
+                  }
+            }
+            solution.resize(6);
+            for (int k = 0; k < 3; ++k) {
+                  solution[k] = difference[k];
+                  solution[3 + k] = rotation[k];
+            }
+            if (solveCholesky(system, solution, 6)) {
+                  glm::vec3 f = wp * glm::vec3(solution[0], solution[1], solution[2]);
+                  glm::vec3 g = wo * glm::vec3(solution[3], solution[4], solution[5]);
+                  for (int i = 0; i < count; ++i) {
+                        glm::vec3 step;
+                        for (int k = 0; k < 3; ++k) {
+                              step[k] = glm::dot(jacobian[3 * i + k], f) + glm::dot(angularJacobian[3 * i + k], g);
+                        }
+                        skeleton.setPose(i, skeleton.poses[i] + step);
+                  }
+                  update();
+
+                  // accept the step and trust the linearization more next time
+                  glm::vec3 newDifference = wp * (target.position - skeleton.getEndLocation(count - 1));
+                  glm::vec3 newRotation = wo * getRotationVector(target.orientation
+                        * glm::transpose(skeleton.worlds[count - 1].rotation));
+                  if (glm::dot(newDifference, newDifference) + glm::dot(newRotation, newRotation) < error) {
+                        damping = glm::max(damping * 0.5f, MIN_DAMPING);
+                        return;
+                  }
+
+                  // reject the step
+                  for (int i = 0; i < count; ++i) {
+                        skeleton.setPose(i, savedPose[i]);
+                  }
+                  update();
+            }
+            // and damp harder
+            damping = glm::min(damping * 4.0f, MAX_DAMPING);
+      }
+}
+
+// One sweep of cyclic coordinate descent, from the end of the chain to the
+// root. Each rotation axis of a joint is turned by the angle that brings the
+// end closest to the target, clamped into the joint limit. Turning a joint
+// does not move its ancestors, so their world matrices stay valid during the
+// sweep and only the end location has to be carried along.
+void Chain::cyclicCoordinateDescent(glm::vec3 target) {
+      glm::vec3 end = skeleton.getEndLocation(skeleton.size() - 1);
+      // if close enough
+      if (glm::length(target - end) <= TOLERANCE) {
+            return;
+      }
+
+      for (int i = skeleton.size() - 1; i >= 0; --i) {
+            glm::vec3 pivot = skeleton.getJointLocation(i);
+            glm::vec3 pose = skeleton.poses[i];
+
+            // x first, changing x leaves the y and z axes unchanged, and y leaves z
+            glm::vec3 axes[3] = { skeleton.getAxisX(i), skeleton.getAxisY(i), skeleton.getAxisZ(i) };
+            for (int k = 0; k < 3; ++k) {
+                  glm::vec3 axis = axes[k];
+
+                  // project both directions onto the plane of rotation
+                  glm::vec3 toEnd = end - pivot;
+                  glm::vec3 toTarget = target - pivot;
+                  toEnd -= axis * glm::dot(axis, toEnd);
+                  toTarget -= axis * glm::dot(axis, toTarget);
+                  if (glm::length(toEnd) < 1e-6f || glm::length(toTarget) < 1e-6f) {
+                        continue;
+                  }
+
+                  // signed angle from the end to the target around the axis
+                  float angle = atan2(glm::dot(axis, glm::cross(toEnd, toTarget)),
+                        glm::dot(toEnd, toTarget));
+
+                  // honor the joint limit and rotate the end by what is left
+                  glm::vec3 newPose = pose;
+                  newPose[k] += angle;
+                  newPose = skeleton.clampPose(i, newPose);
+                  angle = newPose[k] - pose[k];
+                  pose = newPose;
+                  end = pivot + glm::vec3(glm::rotate(angle, axis) * glm::vec4(end - pivot, 0));
+            }
+
+            skeleton.setPose(i, pose);
+      }
+
+      // bring the world matrices up to date with the new pose
+      update();
+}
+
+// One iteration of forward and backward reaching inverse kinematics (FABRIK).
+// The joint locations are first moved as points: backward from the target
+// to the root, then forward from the fixed root, keeping every bone length.
+// The joints are then turned from the root outward to point at the new
+// locations, which projects the result back onto the joint limits.
+void Chain::fabrik(glm::vec3 target) {
+      int count = skeleton.size();
+
+      // joint locations followed by the end of the chain
+      points.resize(count + 1);
+      for (int i = 0; i < count; ++i) {
+            points[i] = skeleton.getJointLocation(i);
+      }
+      points[count] = skeleton.getEndLocation(count - 1);
+      // if close enough
+      if (glm::length(target - points[count]) <= TOLERANCE) {
+            return;
+      }
+
+      lengths.resize(count);
+      for (int i = 0; i < count; ++i) {
+            lengths[i] = glm::distance(points[i], points[i + 1]);
+      }
+
+      // backward reaching, pin the end onto the target
+      glm::vec3 base = points[0];
+      points[count] = target;
+      for (int i = count - 1; i >= 0; --i) {
+            glm::vec3 direction = points[i] - points[i + 1];
+            if (glm::length(direction) > 1e-6f) {
+                  points[i] = points[i + 1] + lengths[i] * glm::normalize(direction);
+            }
+      }
+
+      // forward reaching, pin the root back onto its base
+      points[0] = base;
+      for (int i = 0; i < count; ++i) {
+            glm::vec3 direction = points[i + 1] - points[i];
+            if (glm::length(direction) > 1e-6f) {
+                  points[i + 1] = points[i] + lengths[i] * glm::normalize(direction);
+            }
+      }
+
+      // turn each joint toward the next point, from the root outward so each
+      // joint starts from where its limited parent actually ended up
+      Transform parent = model;
+      for (int i = 0; i < count; ++i) {
+            // bone of the joint in its own frame, up to the next joint or the end
+            glm::vec3 bone = i + 1 < count ? skeleton.offsets[i + 1]
+                  : glm::vec3(0, skeleton.lengths[i], 0);
+
+            skeleton.updateJoint(i, parent);
+            skeleton.pointToward(i, bone, points[i + 1]);
+            skeleton.updateJoint(i, parent);
+            parent = skeleton.worlds[i];
+      }
+}
@@ -1,25 +1,136 @@
 #ifndef _CHAIN_H_
 #define _CHAIN_H_
 
-#include "core.h"
+#include <climits>
+#include "ikcore.h"
+#include "Skeleton.h"
 #include "Joint.h"
+#include "ReachabilityMap.h"
+#include "SolverTelemetry.h"
 
 ////////////////////////////////////////////////////////////////////////////////
 
+// Inverse kinematics methods Chain::moveToward can use for each step
+enum SolverMode {
+	JACOBIAN_TRANSPOSE,
+	DAMPED_LEAST_SQUARES,
+	CYCLIC_COORDINATE_DESCENT,
+	FABRIK,
+	SOLVER_MODE_COUNT
+};
+
+// Distance from the target at which the solvers stop
+const float TOLERANCE = 0.01f;
+// Angle in radians from the target orientation at which the solvers stop
+const float ANGLE_TOLERANCE = 0.01f;
+// Out of reach, the solvers stop once the best error has not dropped by
+// OUT_OF_REACH_IMPROVEMENT tolerances in the last OUT_OF_REACH_STEPS steps
+const int OUT_OF_REACH_STEPS = 32;
+const float OUT_OF_REACH_IMPROVEMENT = 0.5f;
+
+// Bounds of the adaptive damping used by the damped least-squares solvers
+const float MIN_DAMPING = 0.001f;
+const float MAX_DAMPING = 100.0f;
+// how many times a rejected damped least-squares step is retried
+const int MAX_DAMPING_RETRIES = 8;
+
+// Position and orientation for the end of the chain. The orientation is the
+// world rotation of the last joint. The weights trade the position error,
+// in world units, against the orientation error, in radians; a weight of 0
+// leaves that part free.
+struct PoseTarget {
+	glm::vec3 position;
+	glm::mat3 orientation;
+	float positionWeight;
+	float orientationWeight;
+
+	PoseTarget(glm::vec3 position, const glm::mat3& orientation,
+		float positionWeight = 1.0f, float orientationWeight = 1.0f) :
+		position(position), orientation(orientation),
+		positionWeight(positionWeight), orientationWeight(orientationWeight) {
+	}
+};
+
+// Outcome of Chain::solve
+struct SolveResult {
+	int iterations;		// solver steps taken
+	float residual;		// distance from the end of the chain to the target
+	float angle;		// angle from the target orientation, 0 without one
+	bool converged;		// residual and angle are within the tolerances
+	bool reachable;		// false if the chain's reachability map ruled the target out
+	long long elapsed;	// time spent, in microseconds
+};
+
 class Chain
 {
 private:
-	Joint* root;
-	glm::mat4 model;
+	Skeleton skeleton;
+	Transform model;
+	// handles to the skeleton's joints
 	std::vector<Joint*> joints;
 
+	// solver state
+	SolverMode solver;
+	float damping;
+	// 3 x 3N jacobian, one column per rotation axis, joint by joint
+	std::vector<glm::vec3> jacobian;
+	// the rotation axes themselves, the orientation rows of a 6 x 3N jacobian
+	std::vector<glm::vec3> angularJacobian;
+	std::vector<float> system;
+	std::vector<float> solution;
+	// scratch space reused across calls, so solving does not allocate once warm
+	std::vector<glm::vec3> bestPose;
+	std::vector<glm::vec3> savedPose;
+	std::vector<glm::vec3> points;
+	std::vector<float> lengths;
+	// workspace of the chain, not owned
+	const ReachabilityMap* reachability;
+	// convergence statistics of the solves, not owned
+	SolverTelemetry* telemetry;
+
+	glm::vec3 computeJacobian(glm::vec3 point);
+	void computePoseJacobian(glm::vec3 point);
+	float getPoseError(const PoseTarget& target);
+
+	void jacobianTranspose(glm::vec3 target);
+	void dampedLeastSquares(glm::vec3 target);
+	void dampedLeastSquares(const PoseTarget& target);
+	void cyclicCoordinateDescent(glm::vec3 target);
+	void fabrik(glm::vec3 target);
+
 public:
 	Chain(int count, glm::vec3 offset);
+	// chain of the joints of a skeleton, such as a loaded rig, which must be
+	// a single chain (see Skeleton::isChain)
+	Chain(const Skeleton& skeleton, glm::vec3 offset);
 	~Chain();
 
-	void draw(const glm::mat4& viewProjMtx, GLuint shader);
+	// the joint handles point into the skeleton, so a chain is not copied
+	Chain(const Chain&) = delete;
+	Chain& operator=(const Chain&) = delete;
+
 	void update();
 	void moveToward(glm::vec3 target);
+	SolveResult solve(glm::vec3 target, long long budget, int maxIterations = INT_MAX);
+	SolveResult solve(const PoseTarget& target, long long budget, int maxIterations = INT_MAX);
+	float getResidual(glm::vec3 target);
+	float getAngle(const glm::mat3& orientation);
+	// false if the reachability map rules the target out, true without one
+	bool isReachable(glm::vec3 target);
+	glm::vec3 getReachableTarget(glm::vec3 target);
+
+	// Access functions
+	const std::vector<Joint*>& getJoints()	{return joints;}
+	Skeleton& getSkeleton()				{return skeleton;}
+	const Transform& getModel()			{return model;}
+	void setSolver(SolverMode mode)		{solver=mode;}
+	SolverMode getSolver()				{return solver;}
+	void setReachability(const ReachabilityMap* map)	{reachability=map;}
+	const ReachabilityMap* getReachability()	{return reachability;}
+	// collect how every solve converges, null to stop; the telemetry may be
+	// read from other threads while the chain solves
+	void setTelemetry(SolverTelemetry* stats)	{telemetry=stats;}
+	SolverTelemetry* getTelemetry()		{return telemetry;}
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,50 @@
+#include "ChainRenderer.h"
+#include "TraceWriter.h"
+
+////////////////////////////////////////////////////////////////////////////////
+
+ChainRenderer::ChainRenderer(Chain* chain, glm::vec3 color) :
+	chain(chain), color(color)
+{
+	// create a bounding box along the y axis of each joint
+	for (Joint* joint : chain->getJoints()) {
+		boxes.push_back(new Cube(glm::vec3(0), color,
+			glm::vec3(-0.1, 0, -0.1), glm::vec3(0.1, joint->getLength(), 0.1)));
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+ChainRenderer::~ChainRenderer()
+{
+	// delete the boxes, the chain is owned by the caller
+	for (Cube* box : boxes) {
+		delete box;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void ChainRenderer::draw(const glm::mat4& viewProjMtx, GLuint shader)
+{
+	TraceSpan span("ChainRenderer::draw", "render");
+
+	// draw each box with the world matrix of its joint
+	const std::vector<Joint*>& joints = chain->getJoints();
+	for (size_t i = 0; i < joints.size(); ++i) {
+		boxes[i]->draw(viewProjMtx, joints[i]->getWorldMatrix(), shader);
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void ChainRenderer::draw(const glm::mat4& viewProjMtx, const std::vector<Transform>& worlds, GLuint shader)
+{
+	TraceSpan span("ChainRenderer::draw", "render");
+
+	for (size_t i = 0; i < boxes.size() && i < worlds.size(); ++i) {
+		boxes[i]->draw(viewProjMtx, worlds[i].toMat4(), shader);
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,35 @@
+#ifndef _CHAINRENDERER_H_
+#define _CHAINRENDERER_H_
+
+#include "core.h"
+#include "Cube.h"
+#include "Chain.h"
+
+////////////////////////////////////////////////////////////////////////////////
+
+// The ChainRenderer draws a headless Chain. It owns one bounding box per joint
+// and places it with the joint's world matrix, so the chain itself never
+// touches OpenGL.
+
+class ChainRenderer
+{
+private:
+	Chain* chain;
+	glm::vec3 color;
+
+	// one bounding box per joint, in the same order as the chain's joints
+	std::vector<Cube*> boxes;
+
+public:
+	ChainRenderer(Chain* chain, glm::vec3 color = glm::vec3(0, 1, 1));
+	~ChainRenderer();
+
+	void draw(const glm::mat4& viewProjMtx, GLuint shader);
+	// draw the chain in a pose published by another thread, one world
+	// transform per joint
+	void draw(const glm::mat4& viewProjMtx, const std::vector<Transform>& worlds, GLuint shader);
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif
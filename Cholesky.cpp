@@ -0,0 +1,45 @@
+#include <cmath>
+#include "Cholesky.h"
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool solveCholesky(std::vector<float>& a, std::vector<float>& b, int n) {
+	// A = L L^T, with L in the lower triangle of a
+	for (int j = 0; j < n; ++j) {
+		float diagonal = a[j * n + j];
+		for (int k = 0; k < j; ++k) {
+			diagonal -= a[j * n + k] * a[j * n + k];
+		}
+		if (diagonal <= 0) {
+			return false;
+		}
+		diagonal = sqrt(diagonal);
+		a[j * n + j] = diagonal;
+		for (int i = j + 1; i < n; ++i) {
+			float sum = a[i * n + j];
+			for (int k = 0; k < j; ++k) {
+				sum -= a[i * n + k] * a[j * n + k];
+			}
+			a[i * n + j] = sum / diagonal;
+		}
+	}
+
+	// L y = b, then L^T x = y
+	for (int i = 0; i < n; ++i) {
+		float sum = b[i];
+		for (int k = 0; k < i; ++k) {
+			sum -= a[i * n + k] * b[k];
+		}
+		b[i] = sum / a[i * n + i];
+	}
+	for (int i = n - 1; i >= 0; --i) {
+		float sum = b[i];
+		for (int k = i + 1; k < n; ++k) {
+			sum -= a[k * n + i] * b[k];
+		}
+		b[i] = sum / a[i * n + i];
+	}
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
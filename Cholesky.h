@@ -0,0 +1,15 @@
+#ifndef _CHOLESKY_H_
+#define _CHOLESKY_H_
+
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Solve A x = b for a symmetric positive definite n x n matrix A, stored row
+// by row, with a Cholesky decomposition. A is overwritten with its factor and
+// b with the solution. Returns false if A is not positive definite.
+bool solveCholesky(std::vector<float>& a, std::vector<float>& b, int n);
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif
@@ -1,4 +1,5 @@
 #include "Cube.h"
+#include "TraceWriter.h"
 
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -143,12 +144,21 @@ Cube::~Cube()
 
 void Cube::draw(const glm::mat4& viewProjMtx, GLuint shader)
 {
+	draw(viewProjMtx, model, shader);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void Cube::draw(const glm::mat4& viewProjMtx, const glm::mat4& modelMtx, GLuint shader)
+{
+	TraceSpan span("Cube::draw", "render");
+
 	// actiavte the shader program 
 	glUseProgram(shader);
 
 	// get the locations and send the uniforms to the shader 
 	glUniformMatrix4fv(glGetUniformLocation(shader, "viewProj"), 1, false, (float*)&viewProjMtx);
-	glUniformMatrix4fv(glGetUniformLocation(shader, "model"), 1, GL_FALSE, (float*)&model);
+	glUniformMatrix4fv(glGetUniformLocation(shader, "model"), 1, GL_FALSE, (float*)&modelMtx);
 	glUniform3fv(glGetUniformLocation(shader, "DiffuseColor"), 1, &color[0]);
 
 	// Bind the VAO
@@ -27,6 +27,7 @@ public:
 	~Cube();
 
 	void draw(const glm::mat4& viewProjMtx, GLuint shader);
+	void draw(const glm::mat4& viewProjMtx, const glm::mat4& modelMtx, GLuint shader);
 	void update();
 	void translate(glm::vec3 offset);
 	glm::vec3 getLocation();
@@ -0,0 +1,66 @@
+#include <cstdio>
+#include "FrameProfiler.h"
+
+////////////////////////////////////////////////////////////////////////////////
+
+FrameProfiler::FrameProfiler(const char* const* phaseNames, int phaseCount, unsigned int capacity) :
+	phaseNames(phaseNames), phaseCount(phaseCount), next(0), frame(0), enabled(false),
+	origin(std::chrono::steady_clock::now())
+{
+	unsigned long long size = 1;
+	while (size < capacity) {
+		size *= 2;
+	}
+	samples.reset(new Sample[size]);
+	for (unsigned long long i = 0; i < size; ++i) {
+		samples[i].sequence.store(0, std::memory_order_relaxed);
+	}
+	mask = size - 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void FrameProfiler::record(int phase, long long start, long long end) {
+	// claim a slot, mark it as being written, fill it, then publish it
+	unsigned long long index = next.fetch_add(1, std::memory_order_relaxed);
+	Sample& sample = samples[index & mask];
+	sample.sequence.store(2 * index + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	sample.frame.store(frame.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	sample.phase.store(phase, std::memory_order_relaxed);
+	sample.start.store(start, std::memory_order_relaxed);
+	sample.duration.store(end - start, std::memory_order_relaxed);
+	sample.sequence.store(2 * index + 2, std::memory_order_release);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool FrameProfiler::writeCsv(const char* path) const {
+	FILE* file = fopen(path, "w");
+	if (!file) {
+		return false;
+	}
+	fprintf(file, "frame,phase,start_us,duration_us\n");
+
+	unsigned long long end = next.load(std::memory_order_acquire);
+	unsigned long long begin = end > mask + 1 ? end - (mask + 1) : 0;
+	for (unsigned long long index = begin; index < end; ++index) {
+		const Sample& sample = samples[index & mask];
+		// a slot whose sequence changed while it was copied was overwritten
+		unsigned long long sequence = sample.sequence.load(std::memory_order_acquire);
+		int frame = sample.frame.load(std::memory_order_relaxed);
+		int phase = sample.phase.load(std::memory_order_relaxed);
+		long long start = sample.start.load(std::memory_order_relaxed);
+		long long duration = sample.duration.load(std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (sequence != 2 * index + 2 || sample.sequence.load(std::memory_order_relaxed) != sequence) {
+			continue;
+		}
+		fprintf(file, "%d,%s,%.3f,%.3f\n", frame,
+			phase >= 0 && phase < phaseCount ? phaseNames[phase] : "unknown",
+			start * 1e-3, duration * 1e-3);
+	}
+	return fclose(file) == 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
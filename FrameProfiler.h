@@ -0,0 +1,89 @@
+#ifndef _FRAMEPROFILER_H_
+#define _FRAMEPROFILER_H_
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Timings of the phases of each frame, kept in a lock-free ring of the most
+// recent samples. A sample is the frame number, the phase and its start and
+// duration. Any thread can record: a writer claims a slot with one atomic
+// add and publishes it with a sequence number, so it never waits, and a
+// reader skips the slots being overwritten while it copies them. When the
+// profiler is disabled, a ScopedPhase costs a load and a branch.
+
+class FrameProfiler
+{
+private:
+	struct Sample
+	{
+		std::atomic<unsigned long long> sequence;	// 2 * index + 2 once written, odd while writing
+		std::atomic<int> frame;
+		std::atomic<int> phase;
+		std::atomic<long long> start;		// nanoseconds since the profiler was made
+		std::atomic<long long> duration;	// nanoseconds
+	};
+
+	const char* const* phaseNames;
+	int phaseCount;
+	std::unique_ptr<Sample[]> samples;
+	unsigned long long mask;
+	std::atomic<unsigned long long> next;		// index of the next sample
+	std::atomic<int> frame;
+	std::atomic<bool> enabled;
+	std::chrono::steady_clock::time_point origin;
+
+public:
+	// phaseNames must outlive the profiler; capacity is rounded up to a power
+	// of two
+	FrameProfiler(const char* const* phaseNames, int phaseCount, unsigned int capacity = 1 << 16);
+
+	FrameProfiler(const FrameProfiler&) = delete;
+	FrameProfiler& operator=(const FrameProfiler&) = delete;
+
+	void setEnabled(bool on)		{enabled.store(on, std::memory_order_relaxed);}
+	bool isEnabled() const			{return enabled.load(std::memory_order_relaxed);}
+	// samples recorded from here on belong to the next frame
+	void beginFrame()				{frame.fetch_add(1, std::memory_order_relaxed);}
+
+	long long now() const {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now() - origin).count();
+	}
+	void record(int phase, long long start, long long end);
+
+	// Write the samples in the ring, oldest first, as CSV with the columns
+	// frame, phase, start_us and duration_us; false if the file can't be written
+	bool writeCsv(const char* path) const;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Times the scope it lives in as one phase of the current frame
+class ScopedPhase
+{
+private:
+	FrameProfiler* profiler;
+	int phase;
+	long long start;
+
+public:
+	ScopedPhase(FrameProfiler* profiler, int phase) :
+		profiler(profiler && profiler->isEnabled() ? profiler : 0), phase(phase) {
+		start = this->profiler ? this->profiler->now() : 0;
+	}
+	~ScopedPhase() {
+		if (profiler) {
+			profiler->record(phase, start, profiler->now());
+		}
+	}
+
+	ScopedPhase(const ScopedPhase&) = delete;
+	ScopedPhase& operator=(const ScopedPhase&) = delete;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif
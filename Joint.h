@@ -2,51 +2,45 @@
 #define _JOINT_H_
 
 #include <iostream>
-#include "core.h"
+#include "ikcore.h"
+#include "Skeleton.h"
 
+// Handle to one joint of a Skeleton. The joint data lives in the skeleton's
+// arrays; this class gives per-joint access to it for code outside the
+// solver loops, such as ChainRenderer.
 class Joint
 {
 private:
-	GLuint VAO;
-	GLuint VBO_positions, VBO_normals, EBO;
-
-	glm::mat4 W;
-	glm::mat4 L;
-	glm::vec3 color;
-
-	// Bounding Box Information
-	std::vector<glm::vec3> positions;
-	std::vector<glm::vec3> normals;
-	std::vector<unsigned int> indices;
-
-	// joint data
-	float length;
-	glm::vec3 pose;
-	glm::vec3 offset;
-	glm::vec2 rotXLimit;
-	glm::vec2 rotYLimit;
-	glm::vec2 rotZLimit;
-
-	// child joints
-	std::vector<Joint*> children;
-
-	void initializeBox();
+	Skeleton* skeleton;
+	int index;
 
 public:
-	Joint(float length, glm::vec3 pose, glm::vec3 offset,
-		glm::vec2 rotXLimit, glm::vec2 rotYLimit, glm::vec2 rotZLimit);
-	~Joint();
+	Joint(Skeleton* skeleton, int index);
 
-	void addChild(Joint* child);
-	void draw(const glm::mat4& viewProjMtx, const GLuint shader);
-	void update(const glm::mat4& parent);
+	void updateJoint(const Transform& parent);
 	glm::vec3 getJointLocation();
 	glm::vec3 getEndLocation();
 	glm::vec3 jacobianX(glm::vec3 target);
 	glm::vec3 jacobianY(glm::vec3 target);
 	glm::vec3 jacobianZ(glm::vec3 target);
+	// world axes of the pose's x, y and z rotations
+	glm::vec3 getAxisX();
+	glm::vec3 getAxisY();
+	glm::vec3 getAxisZ();
+	glm::vec3 clampPose(glm::vec3 newPose);
 	void incrementPose(glm::vec3 deltaPose);
+	void setPose(glm::vec3 newPose);
+	void pointToward(glm::vec3 bone, glm::vec3 location);
 	void printPose();
+
+	// Access functions
+	int getIndex()					{return index;}
+	int getParent()					{return skeleton->parents[index];}
+	float getLength()				{return skeleton->lengths[index];}
+	const glm::vec3& getPose()		{return skeleton->poses[index];}
+	const glm::vec3& getOffset()		{return skeleton->offsets[index];}
+	const Transform& getWorldTransform()	{return skeleton->worlds[index];}
+	glm::mat4 getWorldMatrix()		{return getWorldTransform().toMat4();}
 };
 
 #endif
\ No newline at end of file
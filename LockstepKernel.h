@@ -0,0 +1,188 @@
+#ifndef _LOCKSTEPKERNEL_H_
+#define _LOCKSTEPKERNEL_H_
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Internal to LockstepSolver. A group of identically structured chains laid out
+// so that one SIMD register holds the same value for consecutive chains ("lanes")
+// of the group: per-lane arrays are indexed [(joint * components + c) * lanes + lane].
+// The structure (parents, lengths, offsets, limits) is shared by all lanes.
+// Only plain pointers are used here, so the kernels built with wider instruction
+// sets do not compile their own copies of inline library code.
+
+struct LockstepGroup
+{
+	int lanes;		// chains in the group, padded to a multiple of the vector width
+	int joints;
+
+	// shared structure, 1 or 3 floats per joint
+	const int* parents;
+	const float* lengths;
+	const float* offsets;
+	const float* lowerLimits;
+	const float* upperLimits;
+
+	// per lane data
+	const float* models;	// 12 floats per lane: 3 axes, then translation
+	const float* targets;	// 3 floats per lane
+	float* poses;			// 3 floats per joint and lane
+	float* worlds;			// 12 floats per joint and lane
+	float* iterations;		// 1 float per lane
+};
+
+// Run up to maxIterations forward kinematics + Jacobian transpose steps on a group
+typedef void (*LockstepKernel)(const LockstepGroup& group, int maxIterations, float tolerance);
+
+// one kernel per instruction set, 0 when the compiler cannot build it
+extern const LockstepKernel lockstepKernelScalar;
+extern const LockstepKernel lockstepKernelSSE;
+extern const LockstepKernel lockstepKernelAVX2;
+
+////////////////////////////////////////////////////////////////////////////////
+
+// The kernel, written once against a vector type V that provides:
+//   V::WIDTH, V::load(p), v.store(p), V::set(f), + - *, min, max,
+//   greater(a, b) -> V::Mask, mask & mask, select(mask, a, b), any(mask).
+
+namespace lockstep {
+
+// round to nearest integer, valid for |x| < 2^22
+template <class V>
+inline V roundNearest(V x) {
+	const V magic = V::set(12582912.0f);
+	return (x + magic) - magic;
+}
+
+// sine and cosine with a Cody-Waite reduction into [-pi/4, pi/4] and
+// minimax polynomials, accurate to a few ulp for the angles a pose uses
+template <class V>
+inline void sinCos(V x, V& s, V& c) {
+	V q = roundNearest(x * V::set(0.636619772f));
+	V r = ((x - q * V::set(1.5703125f)) - q * V::set(4.83751297e-4f)) - q * V::set(7.54978995e-8f);
+	V r2 = r * r;
+
+	V sr = r + r * r2 * (V::set(-1.6666654611e-1f) + r2 * (V::set(8.3321608736e-3f)
+		+ r2 * V::set(-1.9515295891e-4f)));
+	V cr = V::set(1.0f) - V::set(0.5f) * r2 + r2 * r2 * (V::set(4.166664568e-2f)
+		+ r2 * (V::set(-1.388731625e-3f) + r2 * V::set(2.443315711e-5f)));
+
+	// quadrant in 0..3 picks and flips the two results
+	V quadrant = q - V::set(4.0f) * roundNearest(q * V::set(0.25f) - V::set(0.375f));
+	typename V::Mask odd = greater(quadrant, V::set(0.5f)) & greater(V::set(1.5f), quadrant);
+	odd = odd | greater(quadrant, V::set(2.5f));
+	typename V::Mask negSin = greater(quadrant, V::set(1.5f));
+	typename V::Mask negCos = greater(quadrant, V::set(0.5f)) & greater(V::set(2.5f), quadrant);
+
+	V sv = select(odd, cr, sr);
+	V cv = select(odd, sr, cr);
+	s = select(negSin, V::set(0.0f) - sv, sv);
+	c = select(negCos, V::set(0.0f) - cv, cv);
+}
+
+template <class V>
+void iterate(const LockstepGroup& group, int maxIterations, float tolerance)
+{
+	const int W = V::WIDTH;
+	const int joints = group.joints;
+	float* poses = group.poses;
+	float* worlds = group.worlds;
+	const float* models = group.models;
+	const float* targets = group.targets;
+	float* iterations = group.iterations;
+	const V tolerance2 = V::set(tolerance * tolerance);
+
+	for (int lane = 0; lane < group.lanes; lane += W) {
+		V tx = V::load(targets + 0 * group.lanes + lane);
+		V ty = V::load(targets + 1 * group.lanes + lane);
+		V tz = V::load(targets + 2 * group.lanes + lane);
+		V count = V::load(iterations + lane);
+
+		for (int iteration = 0; iteration <= maxIterations; ++iteration) {
+			// forward kinematics, W = parent * translate * rotZ * rotY * rotX
+			for (int j = 0; j < joints; ++j) {
+				float* pose = poses + 3 * j * group.lanes + lane;
+				V sx, cx, sy, cy, sz, cz;
+				sinCos(V::load(pose), sx, cx);
+				sinCos(V::load(pose + group.lanes), sy, cy);
+				sinCos(V::load(pose + 2 * group.lanes), sz, cz);
+
+				// local rotation columns and translation
+				V l[12];
+				l[0] = cz * cy; l[1] = sz * cy; l[2] = V::set(0.0f) - sy;
+				l[3] = cz * sy * sx - sz * cx; l[4] = sz * sy * sx + cz * cx; l[5] = cy * sx;
+				l[6] = cz * sy * cx + sz * sx; l[7] = sz * sy * cx - cz * sx; l[8] = cy * cx;
+				l[9] = V::set(group.offsets[3 * j]);
+				l[10] = V::set(group.offsets[3 * j + 1]);
+				l[11] = V::set(group.offsets[3 * j + 2]);
+
+				int parent = group.parents[j];
+				const float* p = parent < 0 ? models + lane : worlds + 12 * parent * group.lanes + lane;
+				V pm[12];
+				for (int k = 0; k < 12; ++k) {
+					pm[k] = V::load(p + k * group.lanes);
+				}
+
+				// compose the affine transforms
+				float* w = worlds + 12 * j * group.lanes + lane;
+				for (int col = 0; col < 4; ++col) {
+					V x = l[3 * col], y = l[3 * col + 1], z = l[3 * col + 2];
+					for (int row = 0; row < 3; ++row) {
+						V v = pm[row] * x + pm[3 + row] * y + pm[6 + row] * z;
+						if (col == 3) {
+							v = v + pm[9 + row];
+						}
+						v.store(w + (3 * col + row) * group.lanes);
+					}
+				}
+			}
+
+			// end of the last joint and the remaining error
+			const float* last = worlds + 12 * (joints - 1) * group.lanes + lane;
+			V length = V::set(group.lengths[joints - 1]);
+			V dx = tx - (V::load(last + 9 * group.lanes) + length * V::load(last + 3 * group.lanes));
+			V dy = ty - (V::load(last + 10 * group.lanes) + length * V::load(last + 4 * group.lanes));
+			V dz = tz - (V::load(last + 11 * group.lanes) + length * V::load(last + 5 * group.lanes));
+			typename V::Mask active = greater(dx * dx + dy * dy + dz * dz, tolerance2);
+			if (!any(active) || iteration == maxIterations) {
+				break;
+			}
+			count = select(active, count + V::set(1.0f), count);
+
+			// jacobian transpose step on the lanes still moving, the same
+			// gain and clamping as Chain::jacobianTranspose
+			const V gain = V::set(0.001f);
+			for (int j = 0; j < joints; ++j) {
+				const float* w = worlds + 12 * j * group.lanes + lane;
+				V rx = tx - V::load(w + 9 * group.lanes);
+				V ry = ty - V::load(w + 10 * group.lanes);
+				V rz = tz - V::load(w + 11 * group.lanes);
+
+				float* pose = poses + 3 * j * group.lanes + lane;
+				for (int k = 0; k < 3; ++k) {
+					V ax = V::load(w + (3 * k) * group.lanes);
+					V ay = V::load(w + (3 * k + 1) * group.lanes);
+					V az = V::load(w + (3 * k + 2) * group.lanes);
+
+					// dot(cross(axis, target - joint), difference)
+					V jx = ay * rz - az * ry;
+					V jy = az * rx - ax * rz;
+					V jz = ax * ry - ay * rx;
+					V delta = gain * (jx * dx + jy * dy + jz * dz);
+
+					V angle = V::load(pose + k * group.lanes);
+					V moved = min(max(angle + delta, V::set(group.lowerLimits[3 * j + k])),
+						V::set(group.upperLimits[3 * j + k]));
+					select(active, moved, angle).store(pose + k * group.lanes);
+				}
+			}
+		}
+
+		count.store(iterations + lane);
+	}
+}
+
+} // namespace lockstep
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif
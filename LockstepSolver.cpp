@@ -0,0 +1,244 @@
+#include <chrono>
+#include "LockstepSolver.h"
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Scalar stand-in for a SIMD register, used when neither SSE nor AVX2 can run
+
+namespace {
+
+struct ScalarMask {
+	bool m;
+};
+
+struct Scalar {
+	typedef ScalarMask Mask;
+	enum { WIDTH = 1 };
+	float v;
+
+	static Scalar set(float f)				{Scalar r = {f}; return r;}
+	static Scalar load(const float* p)		{return set(*p);}
+	void store(float* p) const				{*p = v;}
+};
+
+inline Scalar operator+(Scalar a, Scalar b)	{return Scalar::set(a.v + b.v);}
+inline Scalar operator-(Scalar a, Scalar b)	{return Scalar::set(a.v - b.v);}
+inline Scalar operator*(Scalar a, Scalar b)	{return Scalar::set(a.v * b.v);}
+inline Scalar min(Scalar a, Scalar b)		{return Scalar::set(a.v < b.v ? a.v : b.v);}
+inline Scalar max(Scalar a, Scalar b)		{return Scalar::set(a.v > b.v ? a.v : b.v);}
+inline ScalarMask greater(Scalar a, Scalar b)	{ScalarMask r = {a.v > b.v}; return r;}
+inline ScalarMask operator&(ScalarMask a, ScalarMask b)	{ScalarMask r = {a.m && b.m}; return r;}
+inline ScalarMask operator|(ScalarMask a, ScalarMask b)	{ScalarMask r = {a.m || b.m}; return r;}
+inline Scalar select(ScalarMask m, Scalar a, Scalar b)	{return m.m ? a : b;}
+inline bool any(ScalarMask m)				{return m.m;}
+
+}
+
+extern const LockstepKernel lockstepKernelScalar = lockstep::iterate<Scalar>;
+
+////////////////////////////////////////////////////////////////////////////////
+
+// what the processor and the operating system can run
+static bool cpuHasSSE2() {
+#if defined(_M_X64) || defined(__x86_64__)
+	return true;
+#elif defined(_MSC_VER) && defined(_M_IX86)
+	int info[4];
+	__cpuid(info, 1);
+	return (info[3] & (1 << 26)) != 0;
+#elif defined(__GNUC__) && defined(__i386__)
+	return __builtin_cpu_supports("sse2");
+#else
+	return false;
+#endif
+}
+
+static bool cpuHasAVX2() {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7) {
+		return false;
+	}
+	// AVX, and the OS saving the ymm registers on a context switch
+	__cpuid(info, 1);
+	if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0 || (_xgetbv(0) & 6) != 6) {
+		return false;
+	}
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	return __builtin_cpu_supports("avx2");
+#else
+	return false;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+LockstepSolver::LockstepSolver() {
+	instructionSet = getSupportedInstructionSet();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+LockstepSolver::InstructionSet LockstepSolver::getSupportedInstructionSet() {
+	if (lockstepKernelAVX2 && cpuHasAVX2()) {
+		return AVX2;
+	}
+	if (lockstepKernelSSE && cpuHasSSE2()) {
+		return SSE;
+	}
+	return SCALAR;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void LockstepSolver::setInstructionSet(InstructionSet set) {
+	InstructionSet supported = getSupportedInstructionSet();
+	instructionSet = set < supported ? set : supported;
+	if (!getKernel(instructionSet)) {
+		instructionSet = SCALAR;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+int LockstepSolver::getLaneCount() {
+	switch (instructionSet) {
+		case AVX2:
+			return 8;
+		case SSE:
+			return 4;
+		default:
+			return 1;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+LockstepKernel LockstepSolver::getKernel(InstructionSet set) {
+	switch (set) {
+		case AVX2:
+			return lockstepKernelAVX2;
+		case SSE:
+			return lockstepKernelSSE;
+		default:
+			return lockstepKernelScalar;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool LockstepSolver::sameStructure(Skeleton& a, Skeleton& b) {
+	// everything but the poses has to match for the chains to share a group
+	return a.parents == b.parents && a.lengths == b.lengths && a.offsets == b.offsets
+		&& a.lowerLimits == b.lowerLimits && a.upperLimits == b.upperLimits;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+std::vector<SolveResult> LockstepSolver::solve(const std::vector<Chain*>& chains,
+	const std::vector<glm::vec3>& targets, int maxIterations)
+{
+	size_t count = glm::min(chains.size(), targets.size());
+	std::vector<SolveResult> results(count);
+	if (count == 0) {
+		return results;
+	}
+
+	// chains shaped like the first one go in the group, the rest are solved alone
+	Skeleton& shape = chains[0]->getSkeleton();
+	std::vector<int> members;
+	for (size_t i = 0; i < count; ++i) {
+		if (shape.size() > 0 && sameStructure(shape, chains[i]->getSkeleton())) {
+			members.push_back((int)i);
+		}
+		else {
+			SolverMode mode = chains[i]->getSolver();
+			chains[i]->setSolver(JACOBIAN_TRANSPOSE);
+			results[i] = chains[i]->solve(targets[i], LLONG_MAX, maxIterations);
+			chains[i]->setSolver(mode);
+		}
+	}
+	if (members.empty()) {
+		return results;
+	}
+	auto start = std::chrono::steady_clock::now();
+
+	// lay the group out, padding the last lanes with copies of the last chain
+	int width = getLaneCount();
+	int lanes = ((int)members.size() + width - 1) / width * width;
+	int joints = shape.size();
+	laneModels.resize(12 * lanes);
+	laneTargets.resize(3 * lanes);
+	lanePoses.resize(3 * joints * lanes);
+	laneWorlds.resize(12 * joints * lanes);
+	laneIterations.assign(lanes, 0.0f);
+
+	for (int lane = 0; lane < lanes; ++lane) {
+		int index = members[glm::min(lane, (int)members.size() - 1)];
+		Chain* chain = chains[index];
+		const Transform& model = chain->getModel();
+		for (int row = 0; row < 3; ++row) {
+			for (int c = 0; c < 3; ++c) {
+				laneModels[(3 * c + row) * lanes + lane] = model.rotation[c][row];
+			}
+			laneModels[(9 + row) * lanes + lane] = model.translation[row];
+		}
+		glm::vec3 goal = chain->getReachableTarget(targets[index]);
+		for (int k = 0; k < 3; ++k) {
+			laneTargets[k * lanes + lane] = goal[k];
+		}
+		const std::vector<glm::vec3>& pose = chain->getSkeleton().poses;
+		for (int j = 0; j < joints; ++j) {
+			for (int k = 0; k < 3; ++k) {
+				lanePoses[(3 * j + k) * lanes + lane] = pose[j][k];
+			}
+		}
+	}
+
+	LockstepGroup group;
+	group.lanes = lanes;
+	group.joints = joints;
+	group.parents = shape.parents.data();
+	group.lengths = shape.lengths.data();
+	group.offsets = &shape.offsets[0].x;
+	group.lowerLimits = &shape.lowerLimits[0].x;
+	group.upperLimits = &shape.upperLimits[0].x;
+	group.models = laneModels.data();
+	group.targets = laneTargets.data();
+	group.poses = lanePoses.data();
+	group.worlds = laneWorlds.data();
+	group.iterations = laneIterations.data();
+
+	getKernel(instructionSet)(group, maxIterations, TOLERANCE);
+	long long elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+		std::chrono::steady_clock::now() - start).count();
+
+	// write the poses back and refresh the world matrices
+	for (int lane = 0; lane < (int)members.size(); ++lane) {
+		int index = members[lane];
+		Chain* chain = chains[index];
+		Skeleton& skeleton = chain->getSkeleton();
+		for (int j = 0; j < joints; ++j) {
+			skeleton.setPose(j, glm::vec3(lanePoses[(3 * j) * lanes + lane],
+				lanePoses[(3 * j + 1) * lanes + lane], lanePoses[(3 * j + 2) * lanes + lane]));
+		}
+		chain->update();
+
+		SolveResult& result = results[index];
+		result.iterations = (int)laneIterations[lane];
+		result.residual = chain->getResidual(targets[index]);
+		result.angle = 0;
+		result.converged = result.residual <= TOLERANCE;
+		result.reachable = chain->isReachable(targets[index]) || result.converged;
+		result.elapsed = elapsed;
+	}
+	return results;
+}
+
+////////////////////////////////////////////////////////////////////////////////
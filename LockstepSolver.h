@@ -0,0 +1,60 @@
+#ifndef _LOCKSTEPSOLVER_H_
+#define _LOCKSTEPSOLVER_H_
+
+#include "ikcore.h"
+#include "Chain.h"
+#include "LockstepKernel.h"
+
+////////////////////////////////////////////////////////////////////////////////
+
+// The LockstepSolver runs the Jacobian transpose method on many chains of the
+// same structure at once, e.g. all built by Chain(6, offset). The chains are
+// laid out so each SIMD lane holds one chain, and forward kinematics and the
+// solver step run on 8 (AVX2), 4 (SSE) or 1 (scalar) chains per instruction.
+// The widest instruction set the CPU supports is picked at construction.
+// Chains that do not share the structure of the first one are solved one by
+// one with Chain::solve instead.
+
+class LockstepSolver
+{
+public:
+	enum InstructionSet {
+		SCALAR,
+		SSE,
+		AVX2
+	};
+
+private:
+	InstructionSet instructionSet;
+
+	// storage for the group, kept between calls to avoid reallocating
+	std::vector<float> laneModels;
+	std::vector<float> laneTargets;
+	std::vector<float> lanePoses;
+	std::vector<float> laneWorlds;
+	std::vector<float> laneIterations;
+
+	bool sameStructure(Skeleton& a, Skeleton& b);
+	LockstepKernel getKernel(InstructionSet set);
+
+public:
+	LockstepSolver();
+
+	// Take up to maxIterations Jacobian transpose steps on each chain toward
+	// targets[i], pulled onto the ball it can reach if beyond
+	// (Chain::getReachableTarget), stopping early for the chains that get
+	// there. The chains are left at the
+	// final pose with their world matrices up to date.
+	std::vector<SolveResult> solve(const std::vector<Chain*>& chains,
+		const std::vector<glm::vec3>& targets, int maxIterations);
+
+	// Falls back to the widest supported instruction set below the one asked for
+	void setInstructionSet(InstructionSet set);
+	InstructionSet getInstructionSet()	{return instructionSet;}
+	int getLaneCount();
+	static InstructionSet getSupportedInstructionSet();
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif
@@ -0,0 +1,52 @@
+#include "LockstepKernel.h"
+
+////////////////////////////////////////////////////////////////////////////////
+
+// AVX2 build of the lockstep kernel, 8 chains per register. Only this file is
+// compiled with AVX2 enabled, LockstepSolver checks the CPU before calling it.
+
+#ifdef __AVX2__
+
+#include <immintrin.h>
+
+namespace {
+
+struct AvxMask {
+	__m256 m;
+};
+
+struct Avx {
+	typedef AvxMask Mask;
+	enum { WIDTH = 8 };
+	__m256 v;
+
+	static Avx make(__m256 m)				{Avx r; r.v = m; return r;}
+	static Avx set(float f)					{return make(_mm256_set1_ps(f));}
+	static Avx load(const float* p)			{return make(_mm256_loadu_ps(p));}
+	void store(float* p) const				{_mm256_storeu_ps(p, v);}
+};
+
+inline AvxMask makeMask(__m256 m)			{AvxMask r; r.m = m; return r;}
+
+inline Avx operator+(Avx a, Avx b)			{return Avx::make(_mm256_add_ps(a.v, b.v));}
+inline Avx operator-(Avx a, Avx b)			{return Avx::make(_mm256_sub_ps(a.v, b.v));}
+inline Avx operator*(Avx a, Avx b)			{return Avx::make(_mm256_mul_ps(a.v, b.v));}
+inline Avx min(Avx a, Avx b)				{return Avx::make(_mm256_min_ps(a.v, b.v));}
+inline Avx max(Avx a, Avx b)				{return Avx::make(_mm256_max_ps(a.v, b.v));}
+inline AvxMask greater(Avx a, Avx b)		{return makeMask(_mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ));}
+inline AvxMask operator&(AvxMask a, AvxMask b)	{return makeMask(_mm256_and_ps(a.m, b.m));}
+inline AvxMask operator|(AvxMask a, AvxMask b)	{return makeMask(_mm256_or_ps(a.m, b.m));}
+inline Avx select(AvxMask m, Avx a, Avx b)	{return Avx::make(_mm256_blendv_ps(b.v, a.v, m.m));}
+inline bool any(AvxMask m)					{return _mm256_movemask_ps(m.m) != 0;}
+
+}
+
+extern const LockstepKernel lockstepKernelAVX2 = lockstep::iterate<Avx>;
+
+#else
+
+extern const LockstepKernel lockstepKernelAVX2 = 0;
+
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
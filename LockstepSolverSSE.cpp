@@ -0,0 +1,55 @@
+#include "LockstepKernel.h"
+
+////////////////////////////////////////////////////////////////////////////////
+
+// SSE build of the lockstep kernel, 4 chains per register
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+
+#include <emmintrin.h>
+
+namespace {
+
+struct SseMask {
+	__m128 m;
+};
+
+struct Sse {
+	typedef SseMask Mask;
+	enum { WIDTH = 4 };
+	__m128 v;
+
+	static Sse make(__m128 m)				{Sse r; r.v = m; return r;}
+	static Sse set(float f)					{return make(_mm_set1_ps(f));}
+	static Sse load(const float* p)			{return make(_mm_loadu_ps(p));}
+	void store(float* p) const				{_mm_storeu_ps(p, v);}
+};
+
+inline SseMask makeMask(__m128 m)			{SseMask r; r.m = m; return r;}
+
+inline Sse operator+(Sse a, Sse b)			{return Sse::make(_mm_add_ps(a.v, b.v));}
+inline Sse operator-(Sse a, Sse b)			{return Sse::make(_mm_sub_ps(a.v, b.v));}
+inline Sse operator*(Sse a, Sse b)			{return Sse::make(_mm_mul_ps(a.v, b.v));}
+inline Sse min(Sse a, Sse b)				{return Sse::make(_mm_min_ps(a.v, b.v));}
+inline Sse max(Sse a, Sse b)				{return Sse::make(_mm_max_ps(a.v, b.v));}
+inline SseMask greater(Sse a, Sse b)		{return makeMask(_mm_cmpgt_ps(a.v, b.v));}
+inline SseMask operator&(SseMask a, SseMask b)	{return makeMask(_mm_and_ps(a.m, b.m));}
+inline SseMask operator|(SseMask a, SseMask b)	{return makeMask(_mm_or_ps(a.m, b.m));}
+inline bool any(SseMask m)					{return _mm_movemask_ps(m.m) != 0;}
+
+inline Sse select(SseMask m, Sse a, Sse b) {
+	// no blend before SSE4.1
+	return Sse::make(_mm_or_ps(_mm_and_ps(m.m, a.v), _mm_andnot_ps(m.m, b.v)));
+}
+
+}
+
+extern const LockstepKernel lockstepKernelSSE = lockstep::iterate<Sse>;
+
+#else
+
+extern const LockstepKernel lockstepKernelSSE = 0;
+
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
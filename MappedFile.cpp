@@ -0,0 +1,125 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+
+MappedFile::MappedFile() :
+	data(0), size(0), opened(false)
+#ifdef _WIN32
+	, file(INVALID_HANDLE_VALUE), mapping(0)
+#endif
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+#ifdef _WIN32
+
+bool MappedFile::open(const char* path) {
+	close();
+	file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+	// pipes and devices have no size to map
+	LARGE_INTEGER length;
+	if (GetFileType(file) != FILE_TYPE_DISK || !GetFileSizeEx(file, &length)) {
+		close();
+		return false;
+	}
+	size = (size_t)length.QuadPart;
+	opened = true;
+
+	// a file mapping can not be empty
+	if (size == 0) {
+		return true;
+	}
+	mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping) {
+		data = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	}
+	if (!data) {
+		close();
+		return false;
+	}
+	return true;
+}
+
+void MappedFile::close() {
+	if (data) {
+		UnmapViewOfFile(data);
+	}
+	if (mapping) {
+		CloseHandle(mapping);
+	}
+	if (file != INVALID_HANDLE_VALUE) {
+		CloseHandle(file);
+	}
+	data = 0;
+	size = 0;
+	opened = false;
+	mapping = 0;
+	file = INVALID_HANDLE_VALUE;
+}
+
+#else
+
+bool MappedFile::open(const char* path) {
+	close();
+	int descriptor = ::open(path, O_RDONLY);
+	if (descriptor < 0) {
+		return false;
+	}
+	// pipes and devices have no size to map
+	struct stat status;
+	if (fstat(descriptor, &status) != 0 || !S_ISREG(status.st_mode)) {
+		::close(descriptor);
+		return false;
+	}
+	size = (size_t)status.st_size;
+
+	// the mapping keeps the file alive, the descriptor is not needed anymore
+	if (size > 0) {
+		void* address = mmap(0, size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+		if (address == MAP_FAILED) {
+			::close(descriptor);
+			size = 0;
+			return false;
+		}
+		data = (const char*)address;
+	}
+	::close(descriptor);
+	opened = true;
+	return true;
+}
+
+void MappedFile::close() {
+	if (data) {
+		munmap((void*)data, size);
+	}
+	data = 0;
+	size = 0;
+	opened = false;
+}
+
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,41 @@
+#ifndef _MAPPEDFILE_H_
+#define _MAPPEDFILE_H_
+
+#include <cstddef>
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Read-only memory mapping of a whole file. The contents are paged in by the
+// OS on first touch, so opening a large file costs nothing up front and
+// reading it involves no copies.
+
+class MappedFile
+{
+private:
+	const char* data;		// null for an empty file
+	size_t size;
+	bool opened;
+#ifdef _WIN32
+	void* file;
+	void* mapping;
+#endif
+
+public:
+	MappedFile();
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	// false if the file can not be opened or mapped
+	bool open(const char* path);
+	void close();
+
+	bool isOpen() const					{return opened;}
+	const char* getData() const			{return data;}
+	size_t getSize() const				{return size;}
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif
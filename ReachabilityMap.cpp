@@ -0,0 +1,155 @@
+#include <random>
+#include "ReachabilityMap.h"
+
+const float ReachabilityMap::HOLE_MARGIN = 0.25f;
+
+////////////////////////////////////////////////////////////////////////////////
+
+ReachabilityMap::ReachabilityMap(const Skeleton& skeleton, int resolution, int samples) :
+	resolution(glm::max(resolution, 1))
+{
+	// no joint gets further from the origin than the offsets on its path from
+	// the root laid end to end, and no bone end further than that plus its length
+	reach = 1e-3f;
+	std::vector<float> distances(skeleton.size());
+	for (int i = 0; i < skeleton.size(); ++i) {
+		int parent = skeleton.parents[i];
+		distances[i] = (parent < 0 ? 0 : distances[parent]) + glm::length(skeleton.offsets[i]);
+		reach = glm::max(reach, distances[i] + skeleton.lengths[i]);
+	}
+	// the grid is the cube around the ball of radius reach
+	voxelSize = 2 * reach / this->resolution;
+	origin = glm::vec3(-reach);
+
+	int count = this->resolution * this->resolution * this->resolution;
+	nearest.assign(count, -1);
+	if (skeleton.size() == 0) {
+		return;
+	}
+
+	// sampling range of each angle, a single turn is enough for wide limits
+	const float pi = 3.14159265f;
+	std::vector<glm::vec3> lower = skeleton.lowerLimits;
+	std::vector<glm::vec3> upper = skeleton.upperLimits;
+	for (int i = 0; i < skeleton.size(); ++i) {
+		for (int k = 0; k < 3; ++k) {
+			if (upper[i][k] - lower[i][k] > 2 * pi) {
+				float middle = glm::clamp(0.0f, lower[i][k] + pi, upper[i][k] - pi);
+				lower[i][k] = middle - pi;
+				upper[i][k] = middle + pi;
+			}
+		}
+	}
+
+	// put the skeleton in random poses and record where its end lands, keeping
+	// the sample closest to the center of each voxel; the seed is fixed so the
+	// map is the same every time
+	Skeleton sampler = skeleton;
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	int end = skeleton.size() - 1;
+	for (int s = 0; s < samples; ++s) {
+		for (int i = 0; i < sampler.size(); ++i) {
+			glm::vec3 pose;
+			for (int k = 0; k < 3; ++k) {
+				pose[k] = lower[i][k] + (upper[i][k] - lower[i][k]) * unit(random);
+			}
+			sampler.setPose(i, pose);
+		}
+		sampler.update(Transform());
+
+		glm::vec3 point = sampler.getEndLocation(end);
+		int voxel = findVoxel(point);
+		if (nearest[voxel] < 0) {
+			nearest[voxel] = (int)points.size();
+			points.push_back(point);
+		}
+		else {
+			glm::vec3 center = getCenter(voxel);
+			glm::vec3& kept = points[nearest[voxel]];
+			if (glm::distance(point, center) < glm::distance(kept, center)) {
+				kept = point;
+			}
+		}
+	}
+
+	computeNearest();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void ReachabilityMap::computeNearest() {
+	// breadth first from all sampled voxels at once, a voxel takes over the
+	// sample of its neighbor whenever that sample is closer than its own
+	std::vector<int> queue;
+	for (int i = 0; i < (int)nearest.size(); ++i) {
+		if (nearest[i] >= 0) {
+			queue.push_back(i);
+		}
+	}
+
+	const int steps[3] = {1, resolution, resolution * resolution};
+	for (size_t head = 0; head < queue.size(); ++head) {
+		int voxel = queue[head];
+		int sample = nearest[voxel];
+		int cell[3] = {voxel % resolution, voxel / resolution % resolution,
+			voxel / (resolution * resolution)};
+
+		for (int axis = 0; axis < 3; ++axis) {
+			for (int direction = -1; direction <= 1; direction += 2) {
+				int next = cell[axis] + direction;
+				if (next < 0 || next >= resolution) {
+					continue;
+				}
+				int neighbor = voxel + direction * steps[axis];
+				glm::vec3 center = getCenter(neighbor);
+				if (nearest[neighbor] < 0 || glm::distance(center, points[sample])
+						< glm::distance(center, points[nearest[neighbor]])) {
+					nearest[neighbor] = sample;
+					queue.push_back(neighbor);
+				}
+			}
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+int ReachabilityMap::findVoxel(glm::vec3 point) const {
+	// voxel containing the point, or the closest one on the border of the grid
+	glm::vec3 cell = glm::floor((point - origin) / voxelSize);
+	cell = glm::clamp(cell, glm::vec3(0), glm::vec3((float)(resolution - 1)));
+	return ((int)cell.z * resolution + (int)cell.y) * resolution + (int)cell.x;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+glm::vec3 ReachabilityMap::getCenter(int voxel) const {
+	glm::vec3 cell((float)(voxel % resolution), (float)(voxel / resolution % resolution),
+		(float)(voxel / (resolution * resolution)));
+	return origin + (cell + 0.5f) * voxelSize;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool ReachabilityMap::isReachable(glm::vec3 point) const {
+	// nothing outside the ball of radius reach is reachable; inside it the
+	// samples thin out toward full stretch, so only a point far from all of
+	// them is taken to be out of reach
+	if (glm::length(point) > reach) {
+		return false;
+	}
+	int sample = nearest[findVoxel(point)];
+	return sample >= 0 && glm::distance(point, points[sample]) <= HOLE_MARGIN * reach;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+glm::vec3 ReachabilityMap::getNearestReachable(glm::vec3 point) const {
+	// the samples are never close enough to stand in for a point, so a point
+	// beyond the ball is pulled onto it and one inside is left alone
+	float distance = glm::length(point);
+	return distance > reach ? point * (reach / distance) : point;
+}
+
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,54 @@
+#ifndef _REACHABILITYMAP_H_
+#define _REACHABILITYMAP_H_
+
+#include "ikcore.h"
+#include "Skeleton.h"
+
+////////////////////////////////////////////////////////////////////////////////
+
+// The ReachabilityMap is a voxel grid over the workspace of a skeleton. It is
+// built once by sampling random poses within the joint limits and keeping one
+// position of the end of the last joint per voxel reached; every voxel then
+// stores the nearest of these samples, so a query is a lookup. The grid is
+// the cube around the ball the end can reach.
+//
+// Random poses rarely come near full stretch, so the map is only trusted to
+// say a point is out of reach: beyond the ball, or inside it but further than
+// HOLE_MARGIN times the reach from every sample, in a hole the joint limits
+// leave. It never moves a point inside the ball. Points are in the
+// skeleton's model space. The map only depends on the structure of the
+// skeleton, so identically built chains can share one.
+
+class ReachabilityMap
+{
+public:
+	static const float HOLE_MARGIN;
+
+private:
+	int resolution;			// voxels along each side of the grid
+	float reach;			// bound on the distance from the origin to the end
+	float voxelSize;
+	glm::vec3 origin;		// minimum corner of the grid
+
+	std::vector<glm::vec3> points;		// one sample per reached voxel
+	std::vector<int> nearest;			// index of the nearest sample per voxel, -1 if none
+
+	int findVoxel(glm::vec3 point) const;
+	glm::vec3 getCenter(int voxel) const;
+	void computeNearest();
+
+public:
+	ReachabilityMap(const Skeleton& skeleton, int resolution = 64, int samples = 100000);
+
+	// false if the end of the chain surely can not get to the point
+	bool isReachable(glm::vec3 point) const;
+	// the point itself inside the ball the end can reach, otherwise its
+	// projection onto the ball
+	glm::vec3 getNearestReachable(glm::vec3 point) const;
+
+	float getVoxelSize() const			{return voxelSize;}
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif
@@ -0,0 +1,126 @@
+#include <cstring>
+#include "Recording.h"
+
+static const char RECORDING_MAGIC[4] = {'I', 'K', 'R', 'C'};
+
+////////////////////////////////////////////////////////////////////////////////
+
+static size_t getFrameSize(int jointCount) {
+	return sizeof(float) * (4 + 3 * jointCount);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+RecordingWriter::RecordingWriter() :
+	file(0), jointCount(0)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+RecordingWriter::~RecordingWriter()
+{
+	close();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool RecordingWriter::open(const char* path, int jointCount) {
+	close();
+	file = fopen(path, "wb");
+	if (!file) {
+		return false;
+	}
+	this->jointCount = jointCount;
+
+	RecordingHeader header;
+	memcpy(header.magic, RECORDING_MAGIC, sizeof(header.magic));
+	header.version = RECORDING_VERSION;
+	header.jointCount = (unsigned int)jointCount;
+	header.frameSize = (unsigned int)getFrameSize(jointCount);
+	if (fwrite(&header, sizeof(header), 1, file) != 1) {
+		close();
+		return false;
+	}
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void RecordingWriter::close() {
+	if (file) {
+		fclose(file);
+		file = 0;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool RecordingWriter::write(float time, glm::vec3 target, const glm::vec3* poses) {
+	// straight into the stdio buffer, nothing is allocated per frame
+	float head[4] = {time, target.x, target.y, target.z};
+	return fwrite(head, sizeof(head), 1, file) == 1
+		&& fwrite(poses, sizeof(glm::vec3), jointCount, file) == (size_t)jointCount;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+Recording::Recording() :
+	jointCount(0), frameCount(0), frameSize(0)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool Recording::open(const char* path) {
+	close();
+	if (!file.open(path)) {
+		return false;
+	}
+
+	RecordingHeader header;
+	if (file.getSize() < sizeof(header)) {
+		close();
+		return false;
+	}
+	memcpy(&header, file.getData(), sizeof(header));
+	if (memcmp(header.magic, RECORDING_MAGIC, sizeof(header.magic)) != 0
+			|| header.version != RECORDING_VERSION
+			|| header.frameSize != getFrameSize(header.jointCount)) {
+		close();
+		return false;
+	}
+
+	jointCount = (int)header.jointCount;
+	frameSize = header.frameSize;
+	frameCount = (int)((file.getSize() - sizeof(header)) / frameSize);
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void Recording::close() {
+	file.close();
+	jointCount = 0;
+	frameCount = 0;
+	frameSize = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+int Recording::findFrame(float time, int hint) const {
+	if (frameCount == 0) {
+		return 0;
+	}
+	// playback moves forward a few frames at a time, so walk from the hint
+	int frame = glm::clamp(hint, 0, frameCount - 1);
+	while (frame > 0 && getTime(frame) > time) {
+		--frame;
+	}
+	while (frame + 1 < frameCount && getTime(frame + 1) <= time) {
+		++frame;
+	}
+	return frame;
+}
+
+////////////////////////////////////////////////////////////////////////////////
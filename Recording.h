@@ -0,0 +1,95 @@
+#ifndef _RECORDING_H_
+#define _RECORDING_H_
+
+#include <cstdio>
+#include "ikcore.h"
+#include "MappedFile.h"
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Binary recording of a chain over time. The file is a 16 byte header
+// followed by fixed size frames, all in native byte order (little-endian on
+// every platform the project builds for):
+//
+//	char magic[4]		"IKRC"
+//	uint32 version		RECORDING_VERSION
+//	uint32 jointCount
+//	uint32 frameSize	bytes per frame, 4 * (4 + 3 * jointCount)
+//
+// and each frame is 32-bit floats: the time in seconds, the target x, y, z,
+// then the x, y, z angles of every joint. Every field is 4 byte aligned, so a
+// mapped file is read in place, and the frame count follows from the file
+// size, so a recording cut short by a crash still replays up to its last
+// whole frame.
+
+static const unsigned int RECORDING_VERSION = 1;
+
+struct RecordingHeader
+{
+	char magic[4];
+	unsigned int version;
+	unsigned int jointCount;
+	unsigned int frameSize;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Appends frames to a recording through a buffered file
+class RecordingWriter
+{
+private:
+	FILE* file;
+	int jointCount;
+
+public:
+	RecordingWriter();
+	~RecordingWriter();
+
+	RecordingWriter(const RecordingWriter&) = delete;
+	RecordingWriter& operator=(const RecordingWriter&) = delete;
+
+	bool open(const char* path, int jointCount);
+	void close();
+	// poses holds jointCount entries
+	bool write(float time, glm::vec3 target, const glm::vec3* poses);
+
+	bool isOpen()						{return file != 0;}
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Maps a recording into memory; frames are pointers into the mapping, valid
+// while the recording stays open
+class Recording
+{
+private:
+	MappedFile file;
+	int jointCount;
+	int frameCount;
+	size_t frameSize;
+
+	const float* getFrame(int frame) const {
+		return (const float*)(file.getData() + sizeof(RecordingHeader) + frame * frameSize);
+	}
+
+public:
+	Recording();
+
+	// false if the file can not be mapped or is not a recording of a version
+	// this code can read
+	bool open(const char* path);
+	void close();
+
+	int getJointCount() const			{return jointCount;}
+	int getFrameCount() const			{return frameCount;}
+	float getTime(int frame) const		{return getFrame(frame)[0];}
+	glm::vec3 getTarget(int frame) const	{return *(const glm::vec3*)(getFrame(frame) + 1);}
+	const glm::vec3* getPoses(int frame) const	{return (const glm::vec3*)(getFrame(frame) + 4);}
+	// last frame at or before the time, starting the search from a hint such as
+	// the previous frame shown, 0 before the first frame
+	int findFrame(float time, int hint = 0) const;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif
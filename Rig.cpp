@@ -0,0 +1,302 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include "Rig.h"
+#include "MappedFile.h"
+#include "Tokenizer.h"
+
+////////////////////////////////////////////////////////////////////////////////
+
+// limit given to rotations the file does not limit
+static const float NO_LIMIT = 100000;
+
+// one joint as read from the file, fields may come after its children
+struct RigJoint
+{
+	int parent;
+	float length;
+	glm::vec3 offset;
+	glm::vec3 pose;
+	glm::vec2 limits[3];
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool loadRig(const char* file, Skeleton& skeleton) {
+	Tokenizer token;
+	if (!token.Open(file)) {
+		return false;
+	}
+
+	std::vector<RigJoint> joints;
+	std::vector<int> open;		// joints whose block is not closed yet, innermost last
+	char name[256];
+	while (true) {
+		token.GetToken(name, sizeof(name));
+		if (name[0] == '\0') {
+			break;
+		}
+
+		if (name[0] == '#') {
+			token.SkipLine();
+		}
+		else if (strcmp(name, "joint") == 0) {
+			// the name is only there for the reader
+			token.GetToken(name, sizeof(name));
+			token.GetToken(name, sizeof(name));
+			if (strcmp(name, "{") != 0) {
+				return token.Abort("expected '{' after the joint name");
+			}
+			RigJoint joint;
+			joint.parent = open.empty() ? -1 : open.back();
+			joint.length = 1;
+			joint.offset = glm::vec3(0);
+			joint.pose = glm::vec3(0);
+			for (glm::vec2& limit : joint.limits) {
+				limit = glm::vec2(-NO_LIMIT, NO_LIMIT);
+			}
+			open.push_back((int)joints.size());
+			joints.push_back(joint);
+		}
+		else if (strcmp(name, "}") == 0) {
+			if (open.empty()) {
+				return token.Abort("unmatched '}'");
+			}
+			open.pop_back();
+		}
+		else if (open.empty()) {
+			return token.Abort("expected a joint");
+		}
+		else {
+			RigJoint& joint = joints[open.back()];
+			if (strcmp(name, "length") == 0) {
+				joint.length = token.GetFloat();
+			}
+			else if (strcmp(name, "offset") == 0) {
+				joint.offset.x = token.GetFloat();
+				joint.offset.y = token.GetFloat();
+				joint.offset.z = token.GetFloat();
+			}
+			else if (strcmp(name, "pose") == 0) {
+				joint.pose.x = token.GetFloat();
+				joint.pose.y = token.GetFloat();
+				joint.pose.z = token.GetFloat();
+			}
+			else if (strcmp(name, "rotxlimit") == 0 || strcmp(name, "rotylimit") == 0
+					|| strcmp(name, "rotzlimit") == 0) {
+				glm::vec2& limit = joint.limits[name[3] - 'x'];
+				limit.x = token.GetFloat();
+				limit.y = token.GetFloat();
+			}
+			else {
+				return token.Abort("unknown joint field");
+			}
+		}
+	}
+	if (!open.empty()) {
+		return token.Abort("missing '}' at the end of the file");
+	}
+	token.Close();
+
+	skeleton.reserve(skeleton.size() + (int)joints.size());
+	int first = skeleton.size();
+	for (const RigJoint& joint : joints) {
+		skeleton.addJoint(joint.parent < 0 ? -1 : first + joint.parent, joint.length,
+			joint.pose, joint.offset, joint.limits[0], joint.limits[1], joint.limits[2]);
+	}
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+int loadRigs(const std::vector<std::string>& files, std::vector<Skeleton>& skeletons,
+	bool cached) {
+	// the files are independent, each thread takes the next one left
+	skeletons.assign(files.size(), Skeleton());
+	std::atomic<int> next(0);
+	std::atomic<int> loaded(0);
+	auto work = [&]() {
+		for (int i = next++; i < (int)files.size(); i = next++) {
+			if (cached ? loadRigCached(files[i].c_str(), skeletons[i])
+					: loadRig(files[i].c_str(), skeletons[i])) {
+				++loaded;
+			}
+			else {
+				skeletons[i] = Skeleton();
+			}
+		}
+	};
+
+	int threadCount = glm::min(glm::max((int)std::thread::hardware_concurrency(), 1),
+		(int)files.size());
+	std::vector<std::thread> threads;
+	for (int i = 1; i < threadCount; ++i) {
+		threads.push_back(std::thread(work));
+	}
+	work();
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+	return loaded;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+static const char RIG_CACHE_MAGIC[4] = {'I', 'K', 'R', 'G'};
+
+struct RigCacheHeader
+{
+	char magic[4];
+	unsigned int version;
+	unsigned long long hash;
+	unsigned int jointCount;
+	unsigned int reserved;
+};
+
+// bytes of the arrays of one joint
+static const size_t RIG_CACHE_JOINT_SIZE = sizeof(int) + sizeof(float)
+	+ 4 * sizeof(glm::vec3) + sizeof(Transform);
+
+////////////////////////////////////////////////////////////////////////////////
+
+unsigned long long hashRig(const char* data, size_t size) {
+	// FNV-1a over 64 bit words in 4 independent lanes, so the multiplies of
+	// one block overlap, then over the bytes left
+	const unsigned long long prime = 1099511628211ULL;
+	unsigned long long lanes[4] = {14695981039346656037ULL, 1, 2, 3};
+	size_t i = 0;
+	for (; i + 32 <= size; i += 32) {
+		unsigned long long words[4];
+		memcpy(words, data + i, sizeof(words));
+		for (int k = 0; k < 4; ++k) {
+			lanes[k] = (lanes[k] ^ words[k]) * prime;
+		}
+	}
+	unsigned long long hash = lanes[0];
+	for (int k = 1; k < 4; ++k) {
+		hash = (hash ^ lanes[k]) * prime;
+	}
+	for (; i < size; ++i) {
+		hash = (hash ^ (unsigned char)data[i]) * prime;
+	}
+	return (hash ^ size) * prime;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// copy count values of an array out of the cache and move past them
+template <class T>
+static void readArray(const char*& data, int count, std::vector<T>& values) {
+	const T* begin = (const T*)data;
+	values.assign(begin, begin + count);
+	data += count * sizeof(T);
+}
+
+bool loadRigCache(const char* cacheFile, unsigned long long hash, Skeleton& skeleton) {
+	MappedFile cache;
+	if (!cache.open(cacheFile) || cache.getSize() < sizeof(RigCacheHeader)) {
+		return false;
+	}
+	RigCacheHeader header;
+	memcpy(&header, cache.getData(), sizeof(header));
+	if (memcmp(header.magic, RIG_CACHE_MAGIC, sizeof(header.magic)) != 0
+			|| header.version != RIG_CACHE_VERSION || header.hash != hash
+			|| cache.getSize() != sizeof(header)
+				+ (unsigned long long)header.jointCount * RIG_CACHE_JOINT_SIZE) {
+		return false;
+	}
+
+	// every array is 4 byte aligned behind the 24 byte header
+	int count = (int)header.jointCount;
+	const char* data = cache.getData() + sizeof(header);
+
+	// a damaged cache of the right size must not reach update(), which needs
+	// every parent to be -1 or an earlier joint
+	const int* parents = (const int*)data;
+	for (int i = 0; i < count; ++i) {
+		if (parents[i] < -1 || parents[i] >= i) {
+			return false;
+		}
+	}
+
+	readArray(data, count, skeleton.parents);
+	readArray(data, count, skeleton.lengths);
+	readArray(data, count, skeleton.offsets);
+	readArray(data, count, skeleton.poses);
+	readArray(data, count, skeleton.lowerLimits);
+	readArray(data, count, skeleton.upperLimits);
+	readArray(data, count, skeleton.locals);
+	skeleton.worlds.assign(count, Transform());
+	skeleton.markAllDirty();
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+template <class T>
+static bool writeArray(FILE* file, const std::vector<T>& values) {
+	return values.empty() || fwrite(&values[0], sizeof(T), values.size(), file) == values.size();
+}
+
+bool saveRigCache(const char* cacheFile, unsigned long long hash, const Skeleton& skeleton) {
+	// write a file of our own and move it over the cache, which replaces it
+	// in one step where rename allows it
+	std::string temporary = std::string(cacheFile) + "."
+		+ std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+	FILE* file = fopen(temporary.c_str(), "wb");
+	if (!file) {
+		return false;
+	}
+
+	RigCacheHeader header;
+	memcpy(header.magic, RIG_CACHE_MAGIC, sizeof(header.magic));
+	header.version = RIG_CACHE_VERSION;
+	header.hash = hash;
+	header.jointCount = (unsigned int)skeleton.size();
+	header.reserved = 0;
+	bool written = fwrite(&header, sizeof(header), 1, file) == 1
+		&& writeArray(file, skeleton.parents)
+		&& writeArray(file, skeleton.lengths)
+		&& writeArray(file, skeleton.offsets)
+		&& writeArray(file, skeleton.poses)
+		&& writeArray(file, skeleton.lowerLimits)
+		&& writeArray(file, skeleton.upperLimits)
+		&& writeArray(file, skeleton.locals);
+	written = fclose(file) == 0 && written;
+
+	if (written && rename(temporary.c_str(), cacheFile) != 0) {
+		// rename does not replace an existing file on Windows
+		remove(cacheFile);
+		written = rename(temporary.c_str(), cacheFile) == 0;
+	}
+	if (!written) {
+		remove(temporary.c_str());
+	}
+	return written;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool loadRigCached(const char* file, Skeleton& skeleton) {
+	MappedFile rig;
+	if (!rig.open(file)) {
+		printf("ERROR: loadRigCached()- Can't open file '%s'\n", file);
+		return false;
+	}
+	unsigned long long hash = hashRig(rig.getData(), rig.getSize());
+	rig.close();
+
+	std::string cacheFile = std::string(file) + ".cache";
+	if (loadRigCache(cacheFile.c_str(), hash, skeleton)) {
+		return true;
+	}
+	if (!loadRig(file, skeleton)) {
+		return false;
+	}
+	saveRigCache(cacheFile.c_str(), hash, skeleton);
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,79 @@
+#ifndef _RIG_H_
+#define _RIG_H_
+
+#include <string>
+#include "ikcore.h"
+#include "Skeleton.h"
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Rig files describe a skeleton as nested joints, read with the Tokenizer:
+//
+//	# comment to the end of the line
+//	joint shoulder {
+//		offset 0 0 0
+//		length 1
+//		pose 0 0 0
+//		rotxlimit 0 0
+//		rotylimit 0 0
+//		rotzlimit -3.14 3.14
+//		joint elbow {
+//			offset 0 1 0
+//			...
+//		}
+//	}
+//
+// Tokens, braces included, are separated by whitespace. Every field is
+// optional: offset and pose default to 0, length to 1, and the limits to
+// none. A joint block may hold several child joints, and the file several
+// roots. Joints are stored in the order their blocks open, which puts parents
+// first as the Skeleton requires. Nesting is tracked with a stack rather than
+// recursion, so deep chains of thousands of joints load fine.
+
+// Load a rig file into an empty skeleton; prints the error and returns false
+// if the file can not be read or is malformed
+bool loadRig(const char* file, Skeleton& skeleton);
+
+// Load several rig files in parallel, one skeleton per file, optionally
+// through their caches (see loadRigCached). Returns the number of files
+// loaded; a file that fails leaves an empty skeleton.
+int loadRigs(const std::vector<std::string>& files, std::vector<Skeleton>& skeletons,
+	bool cached = false);
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Compiled rigs are cached in binary next to the rig file, in file + ".cache".
+// The cache is a 24 byte header followed by the skeleton's arrays as they are
+// in memory, in native byte order:
+//
+//	char magic[4]		"IKRG"
+//	uint32 version		RIG_CACHE_VERSION
+//	uint64 hash			hashRig of the contents of the rig file
+//	uint32 jointCount
+//	uint32 reserved
+//
+// then parents, lengths, offsets, poses, lower limits, upper limits and local
+// transforms, jointCount entries each. Loading it is a mapping and one copy
+// per array. A cache whose hash does not match the rig file is stale and is
+// rebuilt, so editing the rig is enough to refresh it.
+
+static const unsigned int RIG_CACHE_VERSION = 1;
+
+// Load a rig through its cache, parsing the rig file and writing the cache
+// only when the cache is missing or stale. Writing the cache may fail, for
+// instance in a read-only directory, without failing the load.
+bool loadRigCached(const char* file, Skeleton& skeleton);
+
+// The two halves of loadRigCached. loadRigCache fills an empty skeleton and
+// fails on a missing cache, one that does not match the hash or one with a
+// parent that is not -1 or an earlier joint. saveRigCache replaces the cache
+// file at once, so processes starting together never read a partial cache.
+bool loadRigCache(const char* cacheFile, unsigned long long hash, Skeleton& skeleton);
+bool saveRigCache(const char* cacheFile, unsigned long long hash, const Skeleton& skeleton);
+
+// FNV-1a style hash of a rig file's contents, 32 bytes at a time
+unsigned long long hashRig(const char* data, size_t size);
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif
@@ -0,0 +1,239 @@
+#include <algorithm>
+#include "Skeleton.h"
+
+////////////////////////////////////////////////////////////////////////////////
+
+Skeleton::Skeleton() :
+	settled(true), clampCount(0) {
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void Skeleton::reserve(int count) {
+	parents.reserve(count);
+	lengths.reserve(count);
+	offsets.reserve(count);
+	poses.reserve(count);
+	lowerLimits.reserve(count);
+	upperLimits.reserve(count);
+	locals.reserve(count);
+	worlds.reserve(count);
+	dirty.reserve(count);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool Skeleton::isChain() const {
+	for (int i = 0; i < size(); ++i) {
+		if (parents[i] != i - 1) {
+			return false;
+		}
+	}
+	return size() > 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+int Skeleton::addJoint(int parent, float length, glm::vec3 pose, glm::vec3 offset,
+		glm::vec2 rotXLimit, glm::vec2 rotYLimit, glm::vec2 rotZLimit) {
+	// parents must come first so update() can run in a single pass
+	int joint = size();
+	if (parent < -1 || parent >= joint) {
+		return -1;
+	}
+
+	parents.push_back(parent);
+	lengths.push_back(length);
+	offsets.push_back(offset);
+	poses.push_back(pose);
+	lowerLimits.push_back(glm::vec3(rotXLimit.x, rotYLimit.x, rotZLimit.x));
+	upperLimits.push_back(glm::vec3(rotXLimit.y, rotYLimit.y, rotZLimit.y));
+	locals.push_back(Transform());
+	worlds.push_back(Transform());
+	dirty.push_back(0);
+
+	// clamp the pose and calculate local matrix
+	poses[joint] = clampPose(joint, pose);
+	buildLocal(joint);
+	return joint;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void Skeleton::update(const Transform& model) {
+	// a new model matrix moves every root, otherwise only dirty joints change
+	bool moved = model != updatedModel;
+	if (settled && !moved) {
+		return;
+	}
+
+	// calculate world matrices, parents are always updated before children,
+	// so a joint is stale if it is dirty or its parent was just recomputed
+	for (int i = 0; i < size(); ++i) {
+		int parent = parents[i];
+		if (dirty[i] || (parent < 0 ? moved : dirty[parent])) {
+			worlds[i] = (parent < 0 ? model : worlds[parent]) * locals[i];
+			dirty[i] = 1;
+		}
+	}
+
+	std::fill(dirty.begin(), dirty.end(), 0);
+	settled = true;
+	updatedModel = model;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void Skeleton::updateJoint(int joint, const Transform& parent) {
+	// calculate world matrix, leaving the children as they are until the
+	// next update
+	worlds[joint] = parent * locals[joint];
+	markDirty(joint);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void Skeleton::markDirty(int joint) {
+	dirty[joint] = 1;
+	settled = false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void Skeleton::markAllDirty() {
+	dirty.assign(size(), 1);
+	settled = false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+glm::vec3 Skeleton::clampPose(int joint, glm::vec3 newPose) const {
+	// clamp each angle into its limit
+	return glm::clamp(newPose, lowerLimits[joint], upperLimits[joint]);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void Skeleton::setPose(int joint, glm::vec3 newPose) {
+	// clamp the pose so not exceeding limits
+	glm::vec3 pose = clampPose(joint, newPose);
+	// a rotation the limits hold fixed is clamped on every step, only count
+	// the ones that can move
+	for (int axis = 0; axis < 3; ++axis) {
+		if (pose[axis] != newPose[axis] && lowerLimits[joint][axis] < upperLimits[joint][axis]) {
+			++clampCount;
+			break;
+		}
+	}
+	if (pose == poses[joint]) {
+		return;
+	}
+	poses[joint] = pose;
+	buildLocal(joint);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void Skeleton::buildLocal(int joint) {
+	// update local matrix, translate * rotZ * rotY * rotX
+	locals[joint] = Transform::fromEulerZYX(poses[joint], offsets[joint]);
+	markDirty(joint);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void Skeleton::pointToward(int joint, glm::vec3 bone, glm::vec3 location) {
+	const glm::vec3& pose = poses[joint];
+
+	// current and wanted world direction of the bone
+	const glm::mat3& world = worlds[joint].rotation;
+	glm::vec3 current = world * bone;
+	glm::vec3 wanted = location - getJointLocation(joint);
+	if (glm::length(current) < 1e-6f || glm::length(wanted) < 1e-6f) {
+		return;
+	}
+	current = glm::normalize(current);
+	wanted = glm::normalize(wanted);
+
+	// shortest rotation taking the current direction onto the wanted one
+	glm::vec3 axis = glm::cross(current, wanted);
+	float angle = atan2(glm::length(axis), glm::dot(current, wanted));
+	if (glm::length(axis) < 1e-6f) {
+		if (angle < 1.0f) {
+			return;
+		}
+		// opposite directions, turn around any perpendicular axis
+		axis = glm::cross(current, glm::vec3(1, 0, 0));
+		if (glm::length(axis) < 1e-6f) {
+			axis = glm::cross(current, glm::vec3(0, 0, 1));
+		}
+	}
+	glm::mat3 delta = glm::mat3(glm::rotate(angle, glm::normalize(axis)));
+
+	// apply it on top of the current local rotation, W = parent * T * R
+	glm::mat3 rotation = locals[joint].rotation * glm::transpose(world) * delta * world;
+
+	// decompose R = rotZ * rotY * rotX back into the pose
+	glm::vec3 newPose;
+	float sinY = glm::clamp(-rotation[0][2], -1.0f, 1.0f);
+	newPose.y = asin(sinY);
+	if (fabs(sinY) < 0.9999f) {
+		newPose.x = atan2(rotation[1][2], rotation[2][2]);
+		newPose.z = atan2(rotation[0][1], rotation[0][0]);
+	}
+	else {
+		// gimbal lock, keep x and put the rest of the rotation on z
+		newPose.x = pose.x;
+		newPose.z = atan2(-rotation[1][0], rotation[1][1]) + sinY * pose.x;
+	}
+
+	// stay on the same turn as the current pose so limits keep their meaning
+	const float twoPi = 6.28318530718f;
+	for (int k = 0; k < 3; ++k) {
+		newPose[k] += twoPi * floor((pose[k] - newPose[k]) / twoPi + 0.5f);
+	}
+
+	// project onto the joint limits
+	setPose(joint, newPose);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+glm::vec3 Skeleton::getJointLocation(int joint) const {
+	// world location of the joint
+	return worlds[joint].translation;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+glm::vec3 Skeleton::getEndLocation(int joint) const {
+	// world location of the far end of the bone, W * (0, length, 0, 1)
+	const Transform& world = worlds[joint];
+	return world.translation + lengths[joint] * world.rotation[1];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+glm::vec3 Skeleton::getAxisX(int joint) const {
+	// x rotation is applied last, so its axis is the x axis of the joint
+	return worlds[joint].rotation[0];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+glm::vec3 Skeleton::getAxisY(int joint) const {
+	// y axis before the x rotation, i.e. W * inverse(rotX) * (0, 1, 0)
+	const glm::vec3& pose = poses[joint];
+	return worlds[joint].transformVector(glm::vec3(0, cos(pose.x), -sin(pose.x)));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+glm::vec3 Skeleton::getAxisZ(int joint) const {
+	// z axis before the y and x rotations, i.e. W * inverse(rotY * rotX) * (0, 0, 1)
+	const glm::vec3& pose = poses[joint];
+	return worlds[joint].transformVector(glm::vec3(-sin(pose.y),
+		sin(pose.x) * cos(pose.y), cos(pose.x) * cos(pose.y)));
+}
+
+////////////////////////////////////////////////////////////////////////////////
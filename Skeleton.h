@@ -0,0 +1,81 @@
+#ifndef _SKELETON_H_
+#define _SKELETON_H_
+
+#include "ikcore.h"
+#include "Transform.h"
+
+////////////////////////////////////////////////////////////////////////////////
+
+// The Skeleton stores the kinematic data of a set of joints as structure of
+// arrays, so the forward kinematics and solver loops walk contiguous memory.
+// Joints are stored parents first, which lets update() compute every world
+// matrix in a single pass. The arrays are public so the solvers can read them
+// directly; use setPose to change a pose so the local matrix follows.
+// update() only recomputes the joints whose pose changed since the last call,
+// and their descendants, so it costs nothing for a skeleton at rest.
+
+class Skeleton
+{
+private:
+	std::vector<unsigned char> dirty;	// world matrix out of date, one entry per joint
+	bool settled;					// no joint is dirty
+	Transform updatedModel;			// model transform of the last update
+	long long clampCount;			// setPose calls a limit of a free rotation cut short
+
+	void buildLocal(int joint);
+
+public:
+	// joint data, one entry per joint
+	std::vector<int> parents;		// index of the parent joint, -1 for a root
+	std::vector<float> lengths;
+	std::vector<glm::vec3> offsets;
+	std::vector<glm::vec3> poses;
+	std::vector<glm::vec3> lowerLimits;	// lower limit of the x, y and z rotations
+	std::vector<glm::vec3> upperLimits;	// upper limit of the x, y and z rotations
+
+	// transforms, one entry per joint
+	std::vector<Transform> locals;
+	std::vector<Transform> worlds;
+
+	Skeleton();
+
+	// Index of the new joint, or -1 without adding it if the parent is not -1,
+	// for a root, or a joint already added
+	int addJoint(int parent, float length, glm::vec3 pose, glm::vec3 offset,
+		glm::vec2 rotXLimit, glm::vec2 rotYLimit, glm::vec2 rotZLimit);
+	int size() const				{return (int)parents.size();}
+	// make room for count joints in all arrays
+	void reserve(int count);
+	// whether every joint is the child of the one before, as in a Chain
+	bool isChain() const;
+
+	// forward kinematics
+	void update(const Transform& model);
+	void updateJoint(int joint, const Transform& parent);
+	// force the next update to recompute a joint and its descendants, for
+	// code that writes the arrays directly
+	void markDirty(int joint);
+	// the same for every joint, for code that fills the arrays in bulk; the
+	// arrays must all have one entry per joint
+	void markAllDirty();
+	bool isSettled() const			{return settled;}
+
+	// pose
+	glm::vec3 clampPose(int joint, glm::vec3 newPose) const;
+	void setPose(int joint, glm::vec3 newPose);
+	void pointToward(int joint, glm::vec3 bone, glm::vec3 location);
+	// number of poses set so far that were outside the limits of a rotation
+	// that can move; fixed rotations, with equal limits, are not counted
+	long long getClampCount() const	{return clampCount;}
+
+	// world space queries, require up to date world matrices
+	glm::vec3 getJointLocation(int joint) const;
+	glm::vec3 getEndLocation(int joint) const;
+	glm::vec3 getAxisX(int joint) const;
+	glm::vec3 getAxisY(int joint) const;
+	glm::vec3 getAxisZ(int joint) const;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif
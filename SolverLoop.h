@@ -0,0 +1,86 @@
+#ifndef _SOLVERLOOP_H_
+#define _SOLVERLOOP_H_
+
+#include <chrono>
+#include "ikcore.h"
+#include "Skeleton.h"
+#include "Chain.h"
+#include "SolverTelemetry.h"
+#include "TraceWriter.h"
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Shared loop of Chain::solve and Tree::solve: take steps until error() is at
+// most 1, the time budget in microseconds runs out or maxIterations steps were
+// taken. With outOfReach, it also stops once the error stops going down, see
+// OUT_OF_REACH_STEPS. update() brings the world matrices of the skeleton up
+// to date. The skeleton is left at the pose with the lowest error found so
+// far, kept in bestPose, so a solver can reuse it from call to call. Each call
+// and step is a span of the active trace, and with telemetry every step is
+// reported; the goal floats and the target only tell the telemetry which
+// calls aim at the same thing. Only iterations and elapsed are filled in.
+template <class Update, class Step, class Error>
+SolveResult iterateSolver(Skeleton& skeleton, std::vector<glm::vec3>& bestPose,
+	SolverTelemetry* telemetry, long long budget, int maxIterations, const float* goal,
+	int goalSize, glm::vec3 target, bool outOfReach, Update update, Step step, Error error) {
+	TraceSpan span("solve", "solver");
+	auto start = std::chrono::steady_clock::now();
+	SolveResult result;
+	result.iterations = 0;
+
+	// start from the current pose
+	update();
+	float current = error();
+	float best = current;
+	bestPose = skeleton.poses;
+	// best error OUT_OF_REACH_STEPS steps ago
+	float before = current;
+	if (telemetry) {
+		telemetry->beginSolve(goal, goalSize, target, current);
+	}
+
+	long long elapsed = 0;
+	while (current > 1 && result.iterations < maxIterations && elapsed < budget) {
+		{
+			TraceSpan stepSpan("step", "solver");
+			step();
+		}
+		update();
+		++result.iterations;
+
+		// keep track of the best pose, the solvers are not monotonic
+		current = error();
+		if (telemetry) {
+			telemetry->addIteration(current);
+		}
+		if (current < best) {
+			best = current;
+			bestPose = skeleton.poses;
+		}
+		if (outOfReach && result.iterations % OUT_OF_REACH_STEPS == 0) {
+			if (before - best < OUT_OF_REACH_IMPROVEMENT) {
+				break;
+			}
+			before = best;
+		}
+
+		elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+			std::chrono::steady_clock::now() - start).count();
+	}
+
+	// go back to the best pose if the last steps made it worse
+	if (current > best) {
+		for (int i = 0; i < skeleton.size(); ++i) {
+			skeleton.setPose(i, bestPose[i]);
+		}
+		update();
+	}
+
+	result.elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+		std::chrono::steady_clock::now() - start).count();
+	return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif
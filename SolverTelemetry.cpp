@@ -0,0 +1,281 @@
+#include <algorithm>
+#include <bitset>
+#include <cmath>
+#include "SolverTelemetry.h"
+
+const float SolverTelemetry::STALL_IMPROVEMENT = 0.01f;
+
+////////////////////////////////////////////////////////////////////////////////
+
+// add to a counter only one thread writes, without a locked instruction
+template <class T>
+static void bump(std::atomic<T>& counter, T amount) {
+	counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+static void printSolve(FILE* file, const char* label, const SolveTelemetry& solve) {
+	fprintf(file, "%s: target (%g, %g, %g) %lld us, %d iterations, error %.3g%s%s%s\n", label,
+		solve.target.x, solve.target.y, solve.target.z, solve.elapsed, solve.iterations,
+		solve.error, solve.converged ? "" : ", not converged", solve.stalled ? ", stalled" : "",
+		solve.oscillating ? ", oscillating" : "");
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+LogHistogram::LogHistogram()
+{
+	for (std::atomic<long long>& count : counts) {
+		count.store(0, std::memory_order_relaxed);
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void LogHistogram::add(double value) {
+	int bucket = 0;
+	if (value >= 1) {
+		int exponent;
+		std::frexp(value, &exponent);
+		bucket = glm::min(exponent, BUCKET_COUNT - 1);
+	}
+	bump(counts[bucket], 1LL);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+long long LogHistogram::getTotal() const {
+	long long total = 0;
+	for (int i = 0; i < BUCKET_COUNT; ++i) {
+		total += getCount(i);
+	}
+	return total;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+double LogHistogram::getBucketLower(int bucket) {
+	return bucket == 0 ? 0 : std::ldexp(1.0, bucket - 1);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+double LogHistogram::getPercentile(double percentile) const {
+	long long total = getTotal();
+	if (total == 0) {
+		return 0;
+	}
+	long long rank = glm::max((long long)std::ceil(percentile / 100 * total), 1LL);
+	long long seen = 0;
+	for (int i = 0; i < BUCKET_COUNT; ++i) {
+		seen += getCount(i);
+		if (seen >= rank) {
+			return getBucketLower(i + 1);
+		}
+	}
+	return getBucketLower(BUCKET_COUNT);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+SolverTelemetry::SolverTelemetry() :
+	solves(0), converged(0), unreachable(0), stalled(0), oscillating(0), iterations(0),
+	clampHits(0), iteration(0), previous(0), best(0), lastImprovement(0),
+	previousDirection(0), reversals(0), solveStalled(false), solveOscillating(false)
+{
+	for (int i = 0; i < CURVE_LENGTH; ++i) {
+		curveSums[i].store(0, std::memory_order_relaxed);
+		curveCounts[i].store(0, std::memory_order_relaxed);
+	}
+	current = SolveTelemetry();
+	last = SolveTelemetry();
+	pending = SolveTelemetry();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void SolverTelemetry::beginSolve(const float* goalData, int goalSize, glm::vec3 target,
+	float error) {
+	// calls toward the same goal carry on the same solve
+	if (pending.iterations > 0 && goal.size() == (size_t)goalSize
+			&& std::equal(goal.begin(), goal.end(), goalData)) {
+		return;
+	}
+	// the goal moved before the last one was reached
+	finishSolve();
+
+	goal.assign(goalData, goalData + goalSize);
+	pending = SolveTelemetry();
+	pending.target = target;
+	pending.error = error;
+	pending.reachable = true;
+	iteration = 0;
+	previous = error;
+	best = error;
+	lastImprovement = 0;
+	previousDirection = 0;
+	reversals = 0;
+	solveStalled = false;
+	solveOscillating = false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void SolverTelemetry::addIteration(float error) {
+	++iteration;
+	if (iteration <= CURVE_LENGTH) {
+		bump(curveSums[iteration - 1], (double)error);
+		bump(curveCounts[iteration - 1], 1LL);
+	}
+
+	// stall, the best error has not improved enough for a while
+	if (error < best * (1 - STALL_IMPROVEMENT)) {
+		lastImprovement = iteration;
+	}
+	best = glm::min(best, error);
+	if (best > 1 && iteration - lastImprovement >= STALL_WINDOW) {
+		solveStalled = true;
+	}
+
+	// oscillation, most of the recent steps turned the error around
+	int direction = error < previous ? -1 : error > previous ? 1 : 0;
+	bool reversal = direction != 0 && previousDirection != 0 && direction != previousDirection;
+	reversals = (reversals << 1 | (reversal ? 1 : 0)) & 0xffff;
+	if (std::bitset<16>(reversals).count() >= OSCILLATION_REVERSALS) {
+		solveOscillating = true;
+	}
+	if (direction != 0) {
+		previousDirection = direction;
+	}
+	previous = error;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void SolverTelemetry::endSolve(int iterationCount, float error, long long elapsed,
+	int clampHitCount, bool isConverged, bool isReachable) {
+	pending.iterations += iterationCount;
+	pending.error = error;
+	pending.elapsed += elapsed;
+	pending.clampHits += clampHitCount;
+	pending.converged = isConverged;
+	pending.reachable = isReachable;
+	// a solve that got there in the end did not stall
+	pending.stalled = solveStalled && !isConverged;
+	pending.oscillating = solveOscillating;
+
+	if (isConverged) {
+		finishSolve();
+	}
+	else {
+		std::lock_guard<std::mutex> lock(solvesLock);
+		current = pending;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void SolverTelemetry::finishSolve() {
+	// nothing to count if no call toward the goal took a step
+	const SolveTelemetry& solve = pending;
+	if (solve.iterations == 0) {
+		return;
+	}
+
+	bump(solves, 1LL);
+	bump(converged, solve.converged ? 1LL : 0LL);
+	bump(unreachable, solve.reachable ? 0LL : 1LL);
+	bump(stalled, solve.stalled ? 1LL : 0LL);
+	bump(oscillating, solve.oscillating ? 1LL : 0LL);
+	bump(iterations, (long long)solve.iterations);
+	bump(clampHits, (long long)solve.clampHits);
+	if (solve.converged) {
+		iterationHistogram.add(solve.iterations);
+	}
+	errorHistogram.add(solve.error);
+	timeHistogram.add((double)solve.elapsed);
+
+	std::lock_guard<std::mutex> lock(solvesLock);
+	last = solve;
+	current = SolveTelemetry();
+	if ((int)slowest.size() < SLOWEST_COUNT || solve.elapsed > slowest.back().elapsed) {
+		// insert in order, dropping the fastest once full
+		auto at = slowest.begin();
+		while (at != slowest.end() && at->elapsed >= solve.elapsed) {
+			++at;
+		}
+		slowest.insert(at, solve);
+		if ((int)slowest.size() > SLOWEST_COUNT) {
+			slowest.pop_back();
+		}
+	}
+	pending = SolveTelemetry();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+float SolverTelemetry::getCurve(int iteration) const {
+	if (iteration < 1 || iteration > CURVE_LENGTH) {
+		return 0;
+	}
+	long long count = curveCounts[iteration - 1].load(std::memory_order_relaxed);
+	return count > 0 ? (float)(curveSums[iteration - 1].load(std::memory_order_relaxed) / count) : 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+SolveTelemetry SolverTelemetry::getCurrentSolve() const {
+	std::lock_guard<std::mutex> lock(solvesLock);
+	return current;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+SolveTelemetry SolverTelemetry::getLastSolve() const {
+	std::lock_guard<std::mutex> lock(solvesLock);
+	return last;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+std::vector<SolveTelemetry> SolverTelemetry::getSlowestSolves() const {
+	std::lock_guard<std::mutex> lock(solvesLock);
+	return slowest;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void SolverTelemetry::print(FILE* file) const {
+	long long count = getSolves();
+	double share = count > 0 ? 100.0 / count : 0;
+	fprintf(file, "%lld solves, %.1f%% converged, %.1f%% unreachable, %.1f%% stalled, "
+		"%.1f%% oscillating\n", count, getConverged() * share, getUnreachable() * share,
+		getStalled() * share, getOscillating() * share);
+	fprintf(file, "%.1f iterations and %.1f joint limit hits per solve\n",
+		count > 0 ? (double)getIterations() / count : 0,
+		count > 0 ? (double)getClampHits() / count : 0);
+
+	// upper bounds of the power of two buckets
+	const LogHistogram* histograms[3] = {&iterationHistogram, &errorHistogram, &timeHistogram};
+	const char* names[3] = {"iterations to converge", "final error (tolerances)", "time (us)"};
+	for (int i = 0; i < 3; ++i) {
+		fprintf(file, "%-26s p50 <= %-8g p90 <= %-8g p99 <= %g\n", names[i],
+			histograms[i]->getPercentile(50), histograms[i]->getPercentile(90),
+			histograms[i]->getPercentile(99));
+	}
+
+	fprintf(file, "mean error after iteration");
+	for (int i = 1; i <= CURVE_LENGTH; i *= 2) {
+		fprintf(file, " %d: %.3g", i, getCurve(i));
+	}
+	fprintf(file, "\n");
+
+	SolveTelemetry solve = getCurrentSolve();
+	if (solve.iterations > 0) {
+		printSolve(file, "solving", solve);
+	}
+	for (const SolveTelemetry& slow : getSlowestSolves()) {
+		printSolve(file, "slow", slow);
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
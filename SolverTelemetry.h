@@ -0,0 +1,169 @@
+#ifndef _SOLVERTELEMETRY_H_
+#define _SOLVERTELEMETRY_H_
+
+#include <atomic>
+#include <cstdio>
+#include <mutex>
+#include <vector>
+#include "ikcore.h"
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Histogram of positive values in power of two buckets: bucket 0 counts the
+// values below 1 and bucket k the values in [2^(k-1), 2^k), the last bucket
+// also taking everything above. Counts are atomics written by one thread, so
+// other threads can read them at any time.
+
+class LogHistogram
+{
+public:
+	static const int BUCKET_COUNT = 32;
+
+private:
+	std::atomic<long long> counts[BUCKET_COUNT];
+
+public:
+	LogHistogram();
+
+	LogHistogram(const LogHistogram&) = delete;
+	LogHistogram& operator=(const LogHistogram&) = delete;
+
+	// writer side
+	void add(double value);
+
+	long long getCount(int bucket) const	{return counts[bucket].load(std::memory_order_relaxed);}
+	long long getTotal() const;
+	// lower bound of a bucket, 0 for the first
+	static double getBucketLower(int bucket);
+	// upper bound of the bucket holding the given percentile, 0 if empty
+	double getPercentile(double percentile) const;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Outcome of the solves toward one target as the telemetry saw it
+struct SolveTelemetry
+{
+	glm::vec3 target;
+	int iterations;
+	float error;			// final error in tolerances, at most 1 if converged
+	long long elapsed;		// microseconds
+	int clampHits;			// times a joint ran into a limit
+	bool converged;
+	bool reachable;
+	bool stalled;			// the error stopped going down before converging
+	bool oscillating;		// the error kept going up and down
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// SolverTelemetry collects how the solves of a chain converge, see
+// Chain::setTelemetry. Errors are in units of the solver tolerance, as
+// Chain::solve measures them, so 1 is converged whatever the target.
+//
+// A target that takes several calls to solve, such as one frame budget after
+// the other, counts as one solve: the calls toward the same goal add up
+// until the goal changes or the chain converges. Calls that take no step,
+// with the chain already there, are not counted. It keeps:
+// - counts of solves, converged, unreachable, stalled and oscillating solves,
+//   iterations and joint limit hits
+// - histograms of the iterations, the final error and the time per solve
+// - the mean error after each of the first CURVE_LENGTH iterations, the
+//   convergence curve
+// - the solve in progress, the last one finished and the slowest ones, with
+//   their targets
+//
+// A solve stalls when the best error has not dropped by STALL_IMPROVEMENT in
+// the last STALL_WINDOW iterations, and oscillates when at least
+// OSCILLATION_REVERSALS of the last 16 steps turn the error around. Neither
+// stops the solver; they point at the targets and rigs worth a look.
+//
+// One thread, the one solving, writes; any thread may read at any time.
+
+class SolverTelemetry
+{
+public:
+	static const int CURVE_LENGTH = 64;
+	static const int STALL_WINDOW = 16;
+	static const int OSCILLATION_REVERSALS = 10;
+	static const int SLOWEST_COUNT = 8;
+	static const float STALL_IMPROVEMENT;
+
+private:
+	// totals
+	std::atomic<long long> solves;
+	std::atomic<long long> converged;
+	std::atomic<long long> unreachable;
+	std::atomic<long long> stalled;
+	std::atomic<long long> oscillating;
+	std::atomic<long long> iterations;
+	std::atomic<long long> clampHits;
+
+	LogHistogram iterationHistogram;
+	LogHistogram errorHistogram;
+	LogHistogram timeHistogram;
+
+	// sum and count of the errors after each iteration
+	std::atomic<double> curveSums[CURVE_LENGTH];
+	std::atomic<long long> curveCounts[CURVE_LENGTH];
+
+	// solve in progress, last and slowest solves, under the lock
+	mutable std::mutex solvesLock;
+	SolveTelemetry current;
+	SolveTelemetry last;
+	std::vector<SolveTelemetry> slowest;	// slowest first
+
+	// state of the solve in progress, only touched by the writer
+	std::vector<float> goal;	// as the solver gave it, to tell a new goal from the same one
+	SolveTelemetry pending;		// what the calls toward the goal added up to
+	int iteration;
+	float previous;
+	float best;
+	int lastImprovement;		// iteration the best error last dropped enough
+	int previousDirection;		// -1 error went down, 1 up, 0 unchanged
+	unsigned int reversals;		// bit per step, set if it turned the error around
+	bool solveStalled;
+	bool solveOscillating;
+
+	void finishSolve();
+
+public:
+	SolverTelemetry();
+
+	SolverTelemetry(const SolverTelemetry&) = delete;
+	SolverTelemetry& operator=(const SolverTelemetry&) = delete;
+
+	// Writer side, called by Chain::solve around every call. The goal is any
+	// floats that describe what the solver aims at, and target the point
+	// reported for it. endSolve is only called for calls that took a step.
+	void beginSolve(const float* goalData, int goalSize, glm::vec3 target, float error);
+	void addIteration(float error);
+	void endSolve(int iterationCount, float error, long long elapsed, int clampHitCount,
+		bool isConverged, bool isReachable);
+
+	// reader side
+	long long getSolves() const			{return solves.load(std::memory_order_relaxed);}
+	long long getConverged() const		{return converged.load(std::memory_order_relaxed);}
+	long long getUnreachable() const	{return unreachable.load(std::memory_order_relaxed);}
+	long long getStalled() const		{return stalled.load(std::memory_order_relaxed);}
+	long long getOscillating() const	{return oscillating.load(std::memory_order_relaxed);}
+	long long getIterations() const		{return iterations.load(std::memory_order_relaxed);}
+	long long getClampHits() const		{return clampHits.load(std::memory_order_relaxed);}
+	const LogHistogram& getIterationHistogram() const	{return iterationHistogram;}
+	const LogHistogram& getErrorHistogram() const		{return errorHistogram;}
+	const LogHistogram& getTimeHistogram() const		{return timeHistogram;}
+	// mean error after the given iteration, 0 if no solve got that far
+	float getCurve(int iteration) const;
+	// the solve in progress has no iterations if there is none
+	SolveTelemetry getCurrentSolve() const;
+	SolveTelemetry getLastSolve() const;
+	std::vector<SolveTelemetry> getSlowestSolves() const;
+
+	// Print the totals, the percentiles of the histograms and the slowest
+	// solves
+	void print(FILE* file) const;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif
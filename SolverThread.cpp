@@ -0,0 +1,147 @@
+#include <chrono>
+#include "SolverThread.h"
+
+////////////////////////////////////////////////////////////////////////////////
+
+// frame of the chain as it is, before the first tick
+static SolverFrame getInitialFrame(Chain* chain, glm::vec3 target) {
+	chain->update();
+	SolverFrame frame;
+	frame.worlds = chain->getSkeleton().worlds;
+	frame.poses = chain->getSkeleton().poses;
+	frame.target = target;
+	frame.result.iterations = 0;
+	frame.result.residual = 0;
+	frame.result.angle = 0;
+	frame.result.converged = false;
+	frame.result.reachable = true;
+	frame.result.elapsed = 0;
+	frame.tick = 0;
+	return frame;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+SolverThread::SolverThread(Chain* chain, glm::vec3 target, int tickRate, long long budget) :
+	chain(chain), tickRate(glm::max(tickRate, 1)), target(target), pause(false),
+	quit(false), frames(getInitialFrame(chain, target))
+{
+	// by default half of every tick, so a tick that uses up its budget still
+	// leaves room for the copy and for being woken up late
+	long long period = 1000000 / this->tickRate;
+	this->budget = budget > 0 ? glm::min(budget, period) : period / 2;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+SolverThread::~SolverThread()
+{
+	stop();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void SolverThread::start() {
+	if (thread.joinable()) {
+		return;
+	}
+	quit.store(false);
+	thread = std::thread(&SolverThread::run, this);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void SolverThread::stop() {
+	if (!thread.joinable()) {
+		return;
+	}
+	quit.store(true);
+	thread.join();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool SolverThread::post(const SolverCommand& command) {
+	return commands.push(command);
+}
+
+bool SolverThread::setTarget(glm::vec3 target) {
+	SolverCommand command = {SolverCommand::SET_TARGET, target, false, JACOBIAN_TRANSPOSE, 0};
+	return post(command);
+}
+
+bool SolverThread::setPause(bool pause) {
+	SolverCommand command = {SolverCommand::SET_PAUSE, glm::vec3(0), pause, JACOBIAN_TRANSPOSE, 0};
+	return post(command);
+}
+
+bool SolverThread::setSolver(SolverMode solver) {
+	SolverCommand command = {SolverCommand::SET_SOLVER, glm::vec3(0), false, solver, 0};
+	return post(command);
+}
+
+bool SolverThread::setReachability(const ReachabilityMap* reachability) {
+	SolverCommand command = {SolverCommand::SET_REACHABILITY, glm::vec3(0), false,
+		JACOBIAN_TRANSPOSE, reachability};
+	return post(command);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void SolverThread::publish(const SolveResult& result, long long tick) {
+	// the joint count never changes, so copying into the slot does not allocate
+	SolverFrame& frame = frames.getBack();
+	frame.worlds = chain->getSkeleton().worlds;
+	frame.poses = chain->getSkeleton().poses;
+	frame.target = target;
+	frame.result = result;
+	frame.tick = tick;
+	frames.publish();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void SolverThread::run() {
+	typedef std::chrono::steady_clock Clock;
+	const Clock::duration period = std::chrono::microseconds(1000000 / tickRate);
+	Clock::time_point next = Clock::now();
+	SolveResult result = frames.getBack().result;
+
+	for (long long tick = 1; !quit.load(); ++tick) {
+		// apply the input received since the last tick, the last target wins
+		SolverCommand command;
+		while (commands.pop(command)) {
+			switch (command.type) {
+			case SolverCommand::SET_TARGET:
+				target = command.target;
+				break;
+			case SolverCommand::SET_PAUSE:
+				pause = command.pause;
+				break;
+			case SolverCommand::SET_SOLVER:
+				chain->setSolver(command.solver);
+				break;
+			case SolverCommand::SET_REACHABILITY:
+				chain->setReachability(command.reachability);
+				break;
+			}
+		}
+
+		chain->update();
+		if (!pause) {
+			result = chain->solve(target, budget);
+		}
+		publish(result, tick);
+
+		// wait for the next tick; after a stall, start over from now rather
+		// than running a burst of ticks to catch up
+		next += period;
+		Clock::time_point now = Clock::now();
+		if (now > next + period) {
+			next = now;
+		}
+		std::this_thread::sleep_until(next);
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
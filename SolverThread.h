@@ -0,0 +1,98 @@
+#ifndef _SOLVERTHREAD_H_
+#define _SOLVERTHREAD_H_
+
+#include <atomic>
+#include <thread>
+#include "ikcore.h"
+#include "Chain.h"
+#include "SpscQueue.h"
+#include "TripleBuffer.h"
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Change to the solver state, sent from the input thread
+struct SolverCommand
+{
+	enum Type {
+		SET_TARGET,
+		SET_PAUSE,
+		SET_SOLVER,
+		SET_REACHABILITY
+	};
+
+	Type type;
+	glm::vec3 target;
+	bool pause;
+	SolverMode solver;
+	const ReachabilityMap* reachability;
+};
+
+// Pose of the chain after one tick
+struct SolverFrame
+{
+	std::vector<Transform> worlds;	// world transform of each joint
+	std::vector<glm::vec3> poses;	// and its angles
+	glm::vec3 target;
+	SolveResult result;
+	long long tick;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// The SolverThread runs Chain::solve on a thread of its own at a fixed tick
+// rate, so the solver keeps its pace whatever the renderer and the driver do.
+// Input reaches it through a lock-free queue of commands, drained at the
+// start of every tick, and each tick publishes the joint transforms through
+// a lock-free triple buffer the renderer reads the latest frame from. Once
+// the thread is started it owns the chain; the chain may only be used again
+// after stop.
+
+class SolverThread
+{
+private:
+	Chain* chain;
+	int tickRate;			// ticks per second
+	long long budget;		// solver time per tick, in microseconds
+
+	// solver state, only touched by the thread
+	glm::vec3 target;
+	bool pause;
+
+	std::thread thread;
+	std::atomic<bool> quit;
+	SpscQueue<SolverCommand> commands;
+	TripleBuffer<SolverFrame> frames;
+
+	void run();
+	void publish(const SolveResult& result, long long tick);
+
+public:
+	// budget 0 gives every tick half its period
+	SolverThread(Chain* chain, glm::vec3 target, int tickRate = 120, long long budget = 0);
+	~SolverThread();
+
+	SolverThread(const SolverThread&) = delete;
+	SolverThread& operator=(const SolverThread&) = delete;
+
+	void start();
+	void stop();
+
+	// Called from a single input thread. False if the queue is full.
+	bool post(const SolverCommand& command);
+	bool setTarget(glm::vec3 target);
+	bool setPause(bool pause);
+	bool setSolver(SolverMode solver);
+	// the map must outlive the thread
+	bool setReachability(const ReachabilityMap* reachability);
+
+	// Called from a single render thread, the latest published frame. It stays
+	// valid until the next call.
+	const SolverFrame& getFrame()		{return frames.read();}
+
+	int getTickRate()					{return tickRate;}
+	long long getBudget()				{return budget;}
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif
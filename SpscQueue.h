@@ -0,0 +1,62 @@
+#ifndef _SPSCQUEUE_H_
+#define _SPSCQUEUE_H_
+
+#include <atomic>
+#include <memory>
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Lock-free bounded queue between one producer thread and one consumer
+// thread. It is a ring of a power of two slots; the producer only writes
+// tail and the consumer only writes head, so both ends are a load and a
+// store. A push onto a full queue fails rather than waits.
+
+template<class T>
+class SpscQueue
+{
+private:
+	std::unique_ptr<T[]> slots;
+	unsigned int mask;
+	std::atomic<unsigned int> head;		// next slot to pop, written by the consumer
+	std::atomic<unsigned int> tail;		// next slot to push, written by the producer
+
+public:
+	explicit SpscQueue(unsigned int capacity = 256) :
+		head(0), tail(0) {
+		unsigned int size = 1;
+		while (size < capacity) {
+			size *= 2;
+		}
+		slots.reset(new T[size]);
+		mask = size - 1;
+	}
+
+	SpscQueue(const SpscQueue&) = delete;
+	SpscQueue& operator=(const SpscQueue&) = delete;
+
+	// producer side, false if the queue is full
+	bool push(const T& value) {
+		unsigned int t = tail.load(std::memory_order_relaxed);
+		if (t - head.load(std::memory_order_acquire) > mask) {
+			return false;
+		}
+		slots[t & mask] = value;
+		tail.store(t + 1, std::memory_order_release);
+		return true;
+	}
+
+	// consumer side, false if the queue is empty
+	bool pop(T& value) {
+		unsigned int h = head.load(std::memory_order_relaxed);
+		if (h == tail.load(std::memory_order_acquire)) {
+			return false;
+		}
+		value = slots[h & mask];
+		head.store(h + 1, std::memory_order_release);
+		return true;
+	}
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif
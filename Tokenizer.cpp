@@ -4,12 +4,15 @@
 
 #define _CRT_SECURE_NO_WARNINGS
 
+#include <algorithm>
+#include <charconv>
 #include "Tokenizer.h"
 
 ////////////////////////////////////////////////////////////////////////////////
 
 Tokenizer::Tokenizer() {
-	File=0;
+	Begin=Cur=End=0;
+	IsOpen=false;
 	LineNum=0;
 	strcpy(FileName,"");
 }
@@ -17,38 +20,57 @@ Tokenizer::Tokenizer() {
 ////////////////////////////////////////////////////////////////////////////////
 
 Tokenizer::~Tokenizer() {
-	if(File) {
+	if(IsOpen) {
 		printf("ERROR: Tokenizer::~Tokenizer()- Closing file '%s'\n",FileName);
-		fclose((FILE*)File);
+		Close();
 	}
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 
 bool Tokenizer::Open(const char *fname) {
-	File=(void*)fopen(fname,"r");
+	Close();
 	LineNum=1;
-	if(File==0) {
-		printf("ERROR: Tokenzier::Open()- Can't open file '%s'\n",fname);
-		return false;
+	if(Map.open(fname)) {
+		Begin=Map.getData();
+		End=Begin+Map.getSize();
+	}
+	else {
+		// Not a regular file, read it all through stdio instead
+		FILE *file=fopen(fname,"rb");
+		if(file==0) {
+			printf("ERROR: Tokenzier::Open()- Can't open file '%s'\n",fname);
+			return false;
+		}
+		char block[4096];
+		size_t count;
+		while((count=fread(block,1,sizeof(block),file))>0) Buffer.insert(Buffer.end(),block,block+count);
+		fclose(file);
+		Begin=Buffer.data();
+		End=Begin+Buffer.size();
 	}
-	strcpy(FileName,fname);
+	Cur=Begin;
+	IsOpen=true;
+	strncpy(FileName,fname,sizeof(FileName)-1);
+	FileName[sizeof(FileName)-1]='\0';
 	return true;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 
 bool Tokenizer::Close() {
-	if(File) fclose((FILE*)File);
-	else return false;
+	if(!IsOpen) return false;
 
-	File=0;
+	Map.close();
+	std::vector<char>().swap(Buffer);
+	Begin=Cur=End=0;
+	IsOpen=false;
 	return true;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 
-bool Tokenizer::Abort(char *error) {
+bool Tokenizer::Abort(const char *error) {
 	printf("ERROR '%s' line %d: %s\n",FileName,LineNum,error);
 	Close();
 	return false;
@@ -57,7 +79,8 @@ bool Tokenizer::Abort(char *error) {
 ////////////////////////////////////////////////////////////////////////////////
 
 char Tokenizer::GetChar() {
-	char c=char(getc((FILE*)File));
+	if(Cur==End) return char(EOF);
+	char c=*Cur++;
 	if(c=='\n') LineNum++;
 	return c;
 }
@@ -65,126 +88,108 @@ char Tokenizer::GetChar() {
 ////////////////////////////////////////////////////////////////////////////////
 
 char Tokenizer::CheckChar() {
-	int c=getc((FILE*)File);
-	ungetc(c,(FILE*)File);
-	return char(c);
+	if(Cur==End) return char(EOF);
+	return *Cur;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 
+// Uses: [+|-]I
+
 int Tokenizer::GetInt() {
 	SkipWhitespace();
-	int pos=0;
-	char temp[256];
-
-	// Get first character ('-' or digit)
-	char c=CheckChar();
-	if(c=='-') {
-		temp[pos++]=GetChar();
-		c=CheckChar();
-	}
-	if(!isdigit(c)) {
+
+	// from_chars takes a '-' but not a '+'
+	const char *start=Cur;
+	if(start+1<End && start[0]=='+' && start[1]!='-') start++;
+
+	int value=0;
+	std::from_chars_result result=std::from_chars(start,End,value);
+	if(result.ec==std::errc::invalid_argument) {
 		printf("ERROR: Tokenizer::GetInt()- Expecting int on line %d of '%s'\n",LineNum,FileName);
 		return 0;
 	}
-	temp[pos++]=GetChar();
-
-	// Get integer potion
-	while(isdigit(c=CheckChar())) temp[pos++]=GetChar();
-
-	// Finish
-	temp[pos++]='\0';
-	return atoi(temp);
+	Cur=result.ptr;
+	if(result.ec==std::errc::result_out_of_range) {
+		printf("ERROR: Tokenizer::GetInt()- Int out of range on line %d of '%s'\n",LineNum,FileName);
+		return 0;
+	}
+	return value;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 
-// BUG: can't parse ".2", "f", or "F"
-// Uses: [-]I[.[I]][(e|E)[+|-]I]
-// Should use: [+|-](I|I.|.I|I.I)[(e|E)[+|-]I][f|F]
+// Uses: [+|-](I|I.|.I|I.I)[(e|E)[+|-]I][f|F]
 
 float Tokenizer::GetFloat() {
 	SkipWhitespace();
-	int pos=0;
-	char temp[256];
-
-	// Get first character ('-' or digit)
-	char c=CheckChar();
-	if(c=='-') {
-		temp[pos++]=GetChar();
-		c=CheckChar();
+
+	// from_chars takes a '-' but not a '+'
+	const char *start=Cur;
+	if(start+1<End && start[0]=='+' && start[1]!='-') start++;
+
+	float value=0.0f;
+	std::from_chars_result result=std::from_chars(start,End,value);
+	if(result.ec==std::errc::invalid_argument) {
+		printf("ERROR: Tokenizer::GetFloat()- Expecting float on line %d of '%s' '%c'\n",LineNum,FileName,CheckChar());
+		return 0.0f;
 	}
-	if(!isdigit(c)) {
-		printf("ERROR: Tokenizer::GetFloat()- Expecting float on line %d of '%s' '%c'\n",LineNum,FileName,c);
+	Cur=result.ptr;
+	if(result.ec==std::errc::result_out_of_range) {
+		printf("ERROR: Tokenizer::GetFloat()- Float out of range on line %d of '%s'\n",LineNum,FileName);
 		return 0.0f;
 	}
-	temp[pos++]=GetChar();
 
-	// Get integer potion of mantissa
-	while(isdigit(c=CheckChar())) temp[pos++]=GetChar();
+	// Skip the suffix
+	if(Cur<End && (*Cur=='f' || *Cur=='F')) Cur++;
+	return value;
+}
 
-	// Get fraction component
-	if(c=='.') {
-		temp[pos++]=GetChar();
-		while(isdigit(c=CheckChar())) temp[pos++]=GetChar();
-	}
+////////////////////////////////////////////////////////////////////////////////
 
-	// Get exponent
-	if(c=='e' || c=='E') {
-		temp[pos++]=GetChar();
-		c=CheckChar();
-		if(c=='+' || c=='-') {
-			temp[pos++]=GetChar();
-			c=CheckChar();
-		}
-		if(!isdigit(c)) {
-			printf("ERROR: Tokenizer::GetFloat()- Poorly formatted float exponent on line %d of '%s'\n",LineNum,FileName);
-			return 0.0f;
-		}
-		while(isdigit(c=CheckChar())) temp[pos++]=GetChar();
-	}
+bool Tokenizer::GetToken(char *str) {
+	SkipWhitespace();
 
-	// Finish
-	temp[pos++]='\0';
-	return float(atof(temp));
+	const char *start=Cur;
+	while(Cur<End && *Cur!=' ' && *Cur!='\n' && *Cur!='\t' && *Cur!='\r') Cur++;
+	memcpy(str,start,Cur-start);
+	str[Cur-start]='\0';
+	return true;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 
-bool Tokenizer::GetToken(char *str) {
+bool Tokenizer::GetToken(char *str,int size) {
 	SkipWhitespace();
 
-	int pos=0;
-	char c=CheckChar();
-	while(c!=' ' && c!='\n' && c!='\t' && c!='\r' && !feof((FILE*)File)) {
-		str[pos++]=GetChar();
-		c=CheckChar();
-	}
-	str[pos]='\0';
+	const char *start=Cur;
+	while(Cur<End && *Cur!=' ' && *Cur!='\n' && *Cur!='\t' && *Cur!='\r') Cur++;
+	int length=std::min((int)(Cur-start),size-1);
+	memcpy(str,start,length);
+	str[length]='\0';
 	return true;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 
 bool Tokenizer::FindToken(const char *tok) {
-	int pos=0;
-	while(tok[pos]!='\0') {
-		if(feof((FILE*)File)) return false;
-		char c=GetChar();
-		if(c==tok[pos]) pos++;
-		else pos=0;
-	}
-	return true;
+	size_t length=strlen(tok);
+	const char *found=std::search(Cur,End,tok,tok+length);
+
+	// Move past the token, or to the end of the file if it is not there
+	const char *next=(found==End) ? End : found+length;
+	LineNum+=(int)std::count(Cur,next,'\n');
+	Cur=next;
+	return found!=End || length==0;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 
 bool Tokenizer::SkipWhitespace() {
-	char c=CheckChar();
 	bool white=false;
-	while(isspace(c)) {
-		GetChar();
-		c=CheckChar();
+	while(Cur<End && isspace((unsigned char)*Cur)) {
+		if(*Cur=='\n') LineNum++;
+		Cur++;
 		white=true;
 	}
 	return white;
@@ -193,18 +198,23 @@ bool Tokenizer::SkipWhitespace() {
 ////////////////////////////////////////////////////////////////////////////////
 
 bool Tokenizer::SkipLine() {
-	char c=GetChar();
-	while(c!='\n') {
-		if(feof((FILE*)File)) return false;
-		c=GetChar();
+	if(Cur==End) return false;
+	const char *newline=(const char*)memchr(Cur,'\n',End-Cur);
+	if(newline==0) {
+		Cur=End;
+		return false;
 	}
+	Cur=newline+1;
+	LineNum++;
 	return true;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 
 bool Tokenizer::Reset() {
-	if(fseek((FILE*)File,0,SEEK_SET)) return false;
+	if(!IsOpen) return false;
+	Cur=Begin;
+	LineNum=1;
 	return true;
 }
 
@@ -4,7 +4,11 @@
 
 #pragma once
 
-#include "core.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ikcore.h"
+#include "MappedFile.h"
 
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -13,6 +17,10 @@
 // specifically parse integers and floating point numbers. SkipLine will skip to
 // the next carraige return. FindToken searches for a specific token and returns
 // true if it found it.
+//
+// The file is memory mapped and scanned in place, and numbers are parsed
+// straight from the mapping with std::from_chars. Files that can not be mapped
+// are read into memory once instead.
 
 class Tokenizer 
 {
@@ -23,7 +31,7 @@ public:
 	bool Open(const char *file);
 	bool Close();
 
-	bool Abort(char *error);	// Prints error & closes file, and always returns false
+	bool Abort(const char *error);	// Prints error & closes file, and always returns false
 
 	// Tokenization
 	char GetChar();
@@ -31,6 +39,7 @@ public:
 	int GetInt();
 	float GetFloat();
 	bool GetToken(char *str);
+	bool GetToken(char *str,int size);	// truncates to size-1 characters
 	bool FindToken(const char *tok);
 	bool SkipWhitespace();
 	bool SkipLine();
@@ -41,7 +50,12 @@ public:
 	int GetLineNum()			{return LineNum;}
 
 private:
-	void *File;
+	MappedFile Map;
+	std::vector<char> Buffer;	// contents of a file that could not be mapped
+	const char *Begin;
+	const char *Cur;
+	const char *End;
+	bool IsOpen;
 	char FileName[256];
 	int LineNum;
 };
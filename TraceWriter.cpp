@@ -0,0 +1,134 @@
+#include "TraceWriter.h"
+
+std::atomic<TraceWriter*> TraceWriter::active(0);
+
+// every start gets a new id, so threads never reuse a queue of an old trace
+static std::atomic<unsigned long long> nextId(1);
+
+////////////////////////////////////////////////////////////////////////////////
+
+TraceWriter::TraceWriter(unsigned int queueCapacity) :
+	file(0), id(0), queueCapacity(queueCapacity), origin(std::chrono::steady_clock::now()),
+	quit(false), dropped(0), firstEvent(true)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+TraceWriter::~TraceWriter()
+{
+	stop();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool TraceWriter::start(const char* path) {
+	if (file) {
+		return false;
+	}
+	file = fopen(path, "w");
+	if (!file) {
+		return false;
+	}
+
+	// set up before other threads can see the writer
+	id = nextId++;
+	origin = std::chrono::steady_clock::now();
+	dropped = 0;
+	firstEvent = true;
+	TraceWriter* none = 0;
+	if (!active.compare_exchange_strong(none, this)) {
+		fclose(file);
+		file = 0;
+		return false;
+	}
+	fprintf(file, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [");
+
+	quit = false;
+	writer = std::thread(&TraceWriter::run, this);
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void TraceWriter::stop() {
+	if (!file) {
+		return;
+	}
+	active.store(0, std::memory_order_release);
+	quit = true;
+	writer.join();
+
+	fprintf(file, "\n]}\n");
+	fclose(file);
+	file = 0;
+	queues.clear();
+	drained.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+TraceWriter::ThreadQueue* TraceWriter::getQueue() {
+	// the queue of the calling thread, made on its first span
+	static thread_local unsigned long long cachedId = 0;
+	static thread_local ThreadQueue* cachedQueue = 0;
+	if (cachedId != id) {
+		std::lock_guard<std::mutex> lock(queuesLock);
+		queues.push_back(std::unique_ptr<ThreadQueue>(
+			new ThreadQueue(queueCapacity, (int)queues.size() + 1)));
+		cachedQueue = queues.back().get();
+		cachedId = id;
+	}
+	return cachedQueue;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void TraceWriter::record(const char* name, const char* category, long long start, long long end) {
+	TraceEvent event = {name, category, start, end - start};
+	if (!getQueue()->events.push(event)) {
+		dropped.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool TraceWriter::drain() {
+	// pick up the queues of threads that started recording; queues are only
+	// removed once the writer thread is done
+	{
+		std::lock_guard<std::mutex> lock(queuesLock);
+		for (size_t i = drained.size(); i < queues.size(); ++i) {
+			drained.push_back(queues[i].get());
+		}
+	}
+
+	bool any = false;
+	TraceEvent event;
+	for (ThreadQueue* threadQueue : drained) {
+		ThreadQueue& queue = *threadQueue;
+		while (queue.events.pop(event)) {
+			fprintf(file, "%s\n{\"name\": \"%s\", \"cat\": \"%s\", \"ph\": \"X\", \"pid\": 1, "
+				"\"tid\": %d, \"ts\": %.3f, \"dur\": %.3f}", firstEvent ? "" : ",",
+				event.name, event.category, queue.thread, event.start * 1e-3, event.duration * 1e-3);
+			firstEvent = false;
+			any = true;
+		}
+	}
+	return any;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void TraceWriter::run() {
+	// poll rather than be woken, so recording never has to notify
+	while (!quit) {
+		if (!drain()) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	}
+	while (drain()) {
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
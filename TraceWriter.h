@@ -0,0 +1,123 @@
+#ifndef _TRACEWRITER_H_
+#define _TRACEWRITER_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "SpscQueue.h"
+
+////////////////////////////////////////////////////////////////////////////////
+
+// One span of the trace; name and category must be string literals, as the
+// writer thread formats them later
+struct TraceEvent
+{
+	const char* name;
+	const char* category;
+	long long start;		// nanoseconds since the writer started
+	long long duration;		// nanoseconds
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// The TraceWriter records spans from any thread and writes them to a file in
+// the Chrome trace-event format, as complete events ("ph": "X") that
+// chrome://tracing and Perfetto open. Each thread that records gets a
+// lock-free queue of its own the first time it does; a background thread
+// drains the queues and does all the formatting and file writing, so a span
+// costs the recording thread two clock reads and a push. A span that finds
+// its queue full is dropped and counted rather than waited on.
+//
+// At most one writer is active at a time, and TraceSpan records to it; with
+// none active a TraceSpan is a load and a branch. Threads that record must
+// be done before the writer is stopped.
+
+class TraceWriter
+{
+private:
+	struct ThreadQueue
+	{
+		SpscQueue<TraceEvent> events;
+		int thread;				// tid in the trace
+		ThreadQueue(unsigned int capacity, int thread) : events(capacity), thread(thread) {}
+	};
+
+	static std::atomic<TraceWriter*> active;
+
+	FILE* file;
+	unsigned long long id;		// tells writers apart in the threads' caches
+	unsigned int queueCapacity;
+	std::chrono::steady_clock::time_point origin;
+
+	// one queue per recording thread, added under the lock
+	std::mutex queuesLock;
+	std::vector<std::unique_ptr<ThreadQueue>> queues;
+	// the queues the writer thread has seen, only used by it
+	std::vector<ThreadQueue*> drained;
+
+	std::thread writer;
+	std::atomic<bool> quit;
+	std::atomic<long long> dropped;
+	bool firstEvent;
+
+	ThreadQueue* getQueue();
+	bool drain();
+	void run();
+
+public:
+	// queueCapacity is the number of spans each thread can have waiting
+	explicit TraceWriter(unsigned int queueCapacity = 1 << 16);
+	~TraceWriter();
+
+	TraceWriter(const TraceWriter&) = delete;
+	TraceWriter& operator=(const TraceWriter&) = delete;
+
+	// Open the file, start the writer thread and make this the active writer;
+	// false if the file can't be created or another writer is active
+	bool start(const char* path);
+	// Stop recording, write what is left and close the file
+	void stop();
+
+	static TraceWriter* getActive()	{return active.load(std::memory_order_acquire);}
+	long long now() const {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now() - origin).count();
+	}
+	void record(const char* name, const char* category, long long start, long long end);
+	// spans lost to full queues
+	long long getDropped() const	{return dropped.load(std::memory_order_relaxed);}
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Records the scope it lives in as a span of the active trace
+class TraceSpan
+{
+private:
+	TraceWriter* trace;
+	const char* name;
+	const char* category;
+	long long start;
+
+public:
+	TraceSpan(const char* name, const char* category) :
+		trace(TraceWriter::getActive()), name(name), category(category) {
+		start = trace ? trace->now() : 0;
+	}
+	~TraceSpan() {
+		if (trace) {
+			trace->record(name, category, start, trace->now());
+		}
+	}
+
+	TraceSpan(const TraceSpan&) = delete;
+	TraceSpan& operator=(const TraceSpan&) = delete;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif
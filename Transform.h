@@ -0,0 +1,76 @@
+#ifndef _TRANSFORM_H_
+#define _TRANSFORM_H_
+
+#include "ikcore.h"
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Rigid transform stored as a 3x3 rotation and a translation, i.e. the top
+// 3 rows of a 4x4 matrix whose last row is always (0, 0, 0, 1). It takes 12
+// floats instead of 16, and composing two of them needs 36 multiplies
+// instead of the 64 of a mat4 product.
+
+struct Transform
+{
+	glm::mat3 rotation;		// columns are the x, y and z axes
+	glm::vec3 translation;
+
+	Transform() :
+		rotation(1), translation(0) {
+	}
+
+	Transform(const glm::mat3& rotation, const glm::vec3& translation) :
+		rotation(rotation), translation(translation) {
+	}
+
+	explicit Transform(const glm::mat4& matrix) :
+		rotation(matrix), translation(matrix[3]) {
+	}
+
+	// translate(offset) * rotZ * rotY * rotX, built in closed form
+	static Transform fromEulerZYX(glm::vec3 pose, glm::vec3 offset) {
+		float sx = sin(pose.x), cx = cos(pose.x);
+		float sy = sin(pose.y), cy = cos(pose.y);
+		float sz = sin(pose.z), cz = cos(pose.z);
+		return Transform(glm::mat3(
+			cz * cy, sz * cy, -sy,
+			cz * sy * sx - sz * cx, sz * sy * sx + cz * cx, cy * sx,
+			cz * sy * cx + sz * sx, sz * sy * cx - cz * sx, cy * cx), offset);
+	}
+
+	glm::vec3 transformPoint(glm::vec3 point) const {
+		return rotation * point + translation;
+	}
+
+	glm::vec3 transformVector(glm::vec3 vector) const {
+		return rotation * vector;
+	}
+
+	// inverse of a rigid transform, the rotation is orthonormal
+	Transform inverse() const {
+		glm::mat3 transposed = glm::transpose(rotation);
+		return Transform(transposed, -(transposed * translation));
+	}
+
+	glm::mat4 toMat4() const {
+		glm::mat4 matrix(rotation);
+		matrix[3] = glm::vec4(translation, 1);
+		return matrix;
+	}
+};
+
+inline Transform operator*(const Transform& a, const Transform& b) {
+	return Transform(a.rotation * b.rotation, a.rotation * b.translation + a.translation);
+}
+
+inline bool operator==(const Transform& a, const Transform& b) {
+	return a.rotation == b.rotation && a.translation == b.translation;
+}
+
+inline bool operator!=(const Transform& a, const Transform& b) {
+	return !(a == b);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif
@@ -0,0 +1,225 @@
+#include <algorithm>
+#include <limits>
+#include "Tree.h"
+#include "Cholesky.h"
+#include "SolverLoop.h"
+
+////////////////////////////////////////////////////////////////////////////////
+
+Tree::Tree(const Transform& model) :
+	model(model), damping(1.0f), telemetry(0)
+{
+	pathStarts.push_back(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+int Tree::addJoint(int parent, float length, glm::vec3 pose, glm::vec3 offset,
+		glm::vec2 rotXLimit, glm::vec2 rotYLimit, glm::vec2 rotZLimit) {
+	return skeleton.addJoint(parent, length, pose, offset, rotXLimit, rotYLimit, rotZLimit);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+int Tree::addEffector(int joint) {
+	// the joint and its ancestors, the only joints that can move its end
+	int start = (int)paths.size();
+	for (int i = joint; i >= 0; i = skeleton.parents[i]) {
+		paths.push_back(i);
+	}
+	// root first, so the ancestors two effectors share are a common prefix
+	std::reverse(paths.begin() + start, paths.end());
+	pathStarts.push_back((int)paths.size());
+
+	effectors.push_back(joint);
+	return (int)effectors.size() - 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void Tree::update() {
+	skeleton.update(model);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+glm::vec3 Tree::getEffectorLocation(int effector) {
+	return skeleton.getEndLocation(effectors[effector]);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+float Tree::getResidual(const std::vector<glm::vec3>& targets) {
+	if (targets.size() != effectors.size()) {
+		return std::numeric_limits<float>::infinity();
+	}
+	float residual = 0;
+	for (int e = 0; e < (int)effectors.size(); ++e) {
+		residual = glm::max(residual, glm::length(targets[e] - getEffectorLocation(e)));
+	}
+	return residual;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+float Tree::getError(const std::vector<glm::vec3>& targets, std::vector<glm::vec3>& differences) {
+	// squared distances summed over the effectors, the quantity the step minimizes
+	float error = 0;
+	for (int e = 0; e < (int)effectors.size(); ++e) {
+		differences[e] = targets[e] - getEffectorLocation(e);
+		error += glm::dot(differences[e], differences[e]);
+	}
+	return error;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void Tree::computeJacobian() {
+	// rotation axes of every joint; a rotation its limits hold still can not
+	// help, so its axis is left out
+	axes.resize(skeleton.size());
+	for (int i = 0; i < skeleton.size(); ++i) {
+		const glm::vec3& lower = skeleton.lowerLimits[i];
+		const glm::vec3& upper = skeleton.upperLimits[i];
+		axes[i] = glm::mat3(lower.x < upper.x ? skeleton.getAxisX(i) : glm::vec3(0),
+			lower.y < upper.y ? skeleton.getAxisY(i) : glm::vec3(0),
+			lower.z < upper.z ? skeleton.getAxisZ(i) : glm::vec3(0));
+	}
+
+	// one block per effector and joint on its path, the columns are the
+	// derivatives of the effector location with respect to the 3 angles
+	jacobian.resize(paths.size());
+	for (int e = 0; e < (int)effectors.size(); ++e) {
+		glm::vec3 end = getEffectorLocation(e);
+		for (int p = pathStarts[e]; p < pathStarts[e + 1]; ++p) {
+			int joint = paths[p];
+			glm::vec3 arm = end - skeleton.getJointLocation(joint);
+			jacobian[p] = glm::mat3(glm::cross(axes[joint][0], arm),
+				glm::cross(axes[joint][1], arm), glm::cross(axes[joint][2], arm));
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// One Levenberg-Marquardt step of the damped least-squares method over all
+// effectors, as in Chain::dampedLeastSquares with a 3E x 3E system.
+void Tree::moveToward(const std::vector<glm::vec3>& targets) {
+	int count = (int)effectors.size();
+	if ((int)targets.size() != count) {
+		return;
+	}
+	differences.resize(count);
+	float error = getError(targets, differences);
+	// if every effector is close enough
+	if (getResidual(targets) <= TOLERANCE) {
+		return;
+	}
+
+	// J J^T block by block, effectors a and b both depend only on the
+	// joints at the start of their paths that they have in common
+	computeJacobian();
+	int size = 3 * count;
+	system.assign(size * size, 0.0f);
+	for (int a = 0; a < count; ++a) {
+		for (int b = 0; b <= a; ++b) {
+			glm::mat3 block(0);
+			for (int pa = pathStarts[a], pb = pathStarts[b]; pa < pathStarts[a + 1]
+					&& pb < pathStarts[b + 1] && paths[pa] == paths[pb]; ++pa, ++pb) {
+				block += jacobian[pa] * glm::transpose(jacobian[pb]);
+			}
+			for (int row = 0; row < 3; ++row) {
+				for (int col = 0; col < 3; ++col) {
+					system[(3 * a + row) * size + 3 * b + col] = block[col][row];
+					system[(3 * b + col) * size + 3 * a + row] = block[col][row];
+				}
+			}
+		}
+	}
+	savedPose = skeleton.poses;
+	newDifferences.resize(count);
+
+	for (int retry = 0; retry < MAX_DAMPING_RETRIES; ++retry) {
+		// solve the damped system
+		factor = system;
+		for (int i = 0; i < size; ++i) {
+			factor[i * size + i] += damping * damping;
+		}
+		solution.resize(size);
+		for (int e = 0; e < count; ++e) {
+			for (int k = 0; k < 3; ++k) {
+				solution[3 * e + k] = differences[e][k];
+			}
+		}
+		if (!solveCholesky(factor, solution, size)) {
+			damping = glm::min(damping * 4.0f, MAX_DAMPING);
+			continue;
+		}
+
+		// map back through J^T, each effector only moves the joints on its path
+		steps.assign(skeleton.size(), glm::vec3(0));
+		for (int e = 0; e < count; ++e) {
+			glm::vec3 f(solution[3 * e], solution[3 * e + 1], solution[3 * e + 2]);
+			for (int p = pathStarts[e]; p < pathStarts[e + 1]; ++p) {
+				steps[paths[p]] += glm::transpose(jacobian[p]) * f;
+			}
+		}
+		for (int i = 0; i < skeleton.size(); ++i) {
+			skeleton.setPose(i, skeleton.poses[i] + steps[i]);
+		}
+		update();
+
+		// accept the step and trust the linearization more next time
+		if (getError(targets, newDifferences) < error) {
+			damping = glm::max(damping * 0.5f, MIN_DAMPING);
+			return;
+		}
+
+		// reject the step and damp harder
+		for (int i = 0; i < skeleton.size(); ++i) {
+			skeleton.setPose(i, savedPose[i]);
+		}
+		update();
+		damping = glm::min(damping * 4.0f, MAX_DAMPING);
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Iterate until every effector reaches its target, the time budget in
+// microseconds runs out or maxIterations steps were taken, leaving the tree
+// at the best pose found, see iterateSolver. There is one target per
+// effector.
+SolveResult Tree::solve(const std::vector<glm::vec3>& targets, long long budget, int maxIterations) {
+	// without one target per effector there is nothing to aim at
+	if (targets.size() != effectors.size()) {
+		SolveResult result;
+		result.iterations = 0;
+		result.residual = getResidual(targets);
+		result.angle = 0;
+		result.converged = false;
+		result.reachable = false;
+		result.elapsed = 0;
+		return result;
+	}
+	long long clamps = skeleton.getClampCount();
+	glm::vec3 first = targets.empty() ? glm::vec3(0) : targets[0];
+	SolveResult result = iterateSolver(skeleton, bestPose, telemetry, budget, maxIterations,
+		targets.empty() ? 0 : &targets[0].x, 3 * (int)targets.size(), first, false,
+		[&]() { update(); },
+		[&]() { moveToward(targets); },
+		[&]() { return getResidual(targets) / TOLERANCE; });
+
+	result.residual = getResidual(targets);
+	result.angle = 0;
+	result.converged = result.residual <= TOLERANCE;
+	result.reachable = true;
+	// a call that took no step has nothing to add
+	if (telemetry && result.iterations > 0) {
+		telemetry->endSolve(result.iterations, result.residual / TOLERANCE, result.elapsed,
+			(int)(skeleton.getClampCount() - clamps), result.converged, result.reachable);
+	}
+	return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,80 @@
+#ifndef _TREE_H_
+#define _TREE_H_
+
+#include <climits>
+#include "ikcore.h"
+#include "Skeleton.h"
+#include "Chain.h"
+
+////////////////////////////////////////////////////////////////////////////////
+
+// The Tree solves a branching skeleton, such as a humanoid, for several end
+// effectors at once. Each effector is the end of a joint's bone with a target
+// of its own, and all of them are moved together with damped least squares.
+// A joint only moves the effectors below it, so the Jacobian is stored as one
+// 3x3 block per effector and joint on the path from the root to the effector,
+// and the blocks of J J^T only sum over the ancestors two effectors share.
+
+class Tree
+{
+private:
+	Skeleton skeleton;
+	Transform model;
+
+	// effector joints, and the joints each one depends on, root first
+	std::vector<int> effectors;
+	std::vector<int> paths;
+	std::vector<int> pathStarts;	// effector e uses paths[pathStarts[e]] to paths[pathStarts[e + 1]]
+
+	// solver state
+	float damping;
+	std::vector<glm::mat3> axes;		// world rotation axes of each joint, as columns
+	std::vector<glm::mat3> jacobian;	// one block per entry of paths
+	std::vector<float> system;			// J J^T, 3E x 3E
+	std::vector<float> factor;			// its damped Cholesky factor
+	std::vector<float> solution;
+	std::vector<glm::vec3> steps;		// pose change of each joint
+	std::vector<glm::vec3> differences;		// from each effector to its target
+	std::vector<glm::vec3> newDifferences;	// the same after a trial step
+	std::vector<glm::vec3> savedPose;		// to undo a rejected step
+	std::vector<glm::vec3> bestPose;
+	// convergence statistics of the solves, not owned
+	SolverTelemetry* telemetry;
+
+	void computeJacobian();
+	float getError(const std::vector<glm::vec3>& targets, std::vector<glm::vec3>& differences);
+
+public:
+	Tree(const Transform& model = Transform());
+
+	// see Skeleton::addJoint, -1 for an invalid parent
+	int addJoint(int parent, float length, glm::vec3 pose, glm::vec3 offset,
+		glm::vec2 rotXLimit, glm::vec2 rotYLimit, glm::vec2 rotZLimit);
+	int addEffector(int joint);
+
+	void update();
+	// one damped least-squares step toward targets[e] for each effector e,
+	// none unless there is one target per effector
+	void moveToward(const std::vector<glm::vec3>& targets);
+	// iterate until every effector is within the tolerance, see Chain::solve;
+	// without one target per effector it takes no step and does not converge
+	SolveResult solve(const std::vector<glm::vec3>& targets, long long budget,
+		int maxIterations = INT_MAX);
+	// largest distance from an effector to its target, infinite without one
+	// target per effector
+	float getResidual(const std::vector<glm::vec3>& targets);
+	glm::vec3 getEffectorLocation(int effector);
+
+	// Access functions
+	Skeleton& getSkeleton()				{return skeleton;}
+	const Transform& getModel()			{return model;}
+	const std::vector<int>& getEffectors()	{return effectors;}
+	// collect how every solve converges, see Chain::setTelemetry; a solve is
+	// reported at the target of the first effector
+	void setTelemetry(SolverTelemetry* stats)	{telemetry=stats;}
+	SolverTelemetry* getTelemetry()		{return telemetry;}
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif
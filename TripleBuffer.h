@@ -0,0 +1,60 @@
+#ifndef _TRIPLEBUFFER_H_
+#define _TRIPLEBUFFER_H_
+
+#include <atomic>
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Lock-free triple buffer handing the latest value from one writer thread to
+// one reader thread. The writer fills its back slot and swaps it with the
+// middle one; the reader swaps its front slot with the middle one whenever
+// the middle holds something newer. Neither side ever waits, the reader
+// always sees a complete value, and values the reader was too slow to pick
+// up are dropped. Slots are reused, so values that hold vectors of the same
+// size do not allocate once the buffer is warm.
+
+template<class T>
+class TripleBuffer
+{
+private:
+	static const int INDEX_MASK = 3;
+	static const int FRESH = 4;	// set in middle when the writer published since the last read
+
+	T slots[3];
+	int back;					// only touched by the writer
+	int front;					// only touched by the reader
+	std::atomic<int> middle;
+
+public:
+	TripleBuffer() :
+		back(0), front(1), middle(2) {
+	}
+
+	explicit TripleBuffer(const T& value) :
+		back(0), front(1), middle(2) {
+		for (T& slot : slots) {
+			slot = value;
+		}
+	}
+
+	TripleBuffer(const TripleBuffer&) = delete;
+	TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+	// writer side: fill getBack(), then publish it
+	T& getBack()				{return slots[back];}
+	void publish() {
+		back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & INDEX_MASK;
+	}
+
+	// reader side: the latest published value, stays valid until the next call
+	const T& read() {
+		if (middle.load(std::memory_order_relaxed) & FRESH) {
+			front = middle.exchange(front, std::memory_order_acq_rel) & INDEX_MASK;
+		}
+		return slots[front];
+	}
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif
@@ -16,9 +16,58 @@ bool Window::pause = 0;
 bool Window::wireMode = 0;
 bool Window::cullingMode = 0;
 
+// Time the solver may spend each frame, in microseconds
+long long Window::solveBudget = 2000;
+int Window::solverTickRate = 0;
+SolverMode Window::solver;
+
+// Recording and playback, at most RECORD_RATE frames are written per second
+static const double RECORD_RATE = 120;
+const char* Window::rigPath = 0;
+const char* Window::recordPath = 0;
+const char* Window::replayPath = 0;
+double Window::recordStart;
+double Window::recordTime;
+double Window::replayStart;
+int Window::replayFrame;
+
+// Phases of a frame the profiler times
+enum FramePhase
+{
+	PHASE_CAMERA,
+	PHASE_TARGET,
+	PHASE_REPLAY,
+	PHASE_CHAIN_UPDATE,
+	PHASE_SOLVE,
+	PHASE_RECORD,
+	PHASE_CLEAR,
+	PHASE_DRAW_LAND,
+	PHASE_DRAW_CHAIN,
+	PHASE_DRAW_TARGET,
+	PHASE_POLL_EVENTS,
+	PHASE_SWAP_BUFFERS,
+	PHASE_COUNT
+};
+static const char* phaseNames[PHASE_COUNT] = {
+	"camera", "target", "replay", "chain update", "solve", "record",
+	"clear", "draw land", "draw chain", "draw target", "poll events", "swap buffers"
+};
+const char* Window::profilePath = 0;
+const char* Window::tracePath = 0;
+
 // Objects to render
 Cube* Window::land;
 Chain* Window::chain;
+ReachabilityMap* Window::reachability;
+std::future<ReachabilityMap*> Window::reachabilityBuild;
+bool Window::reachabilityAttached = false;
+SolverTelemetry* Window::telemetry;
+ChainRenderer* Window::chainRenderer;
+SolverThread* Window::solverThread;
+RecordingWriter* Window::recorder;
+Recording* Window::replay;
+FrameProfiler* Window::profiler;
+TraceWriter* Window::trace;
 Cube * Window::target;
 
 // Camera Properties
@@ -28,6 +77,14 @@ Camera* Cam;
 bool LeftDown, RightDown;
 int MouseX, MouseY;
 
+// Names of the solvers, in SolverMode order
+static const char* solverNames[SOLVER_MODE_COUNT] = {
+	"Jacobian Transpose",
+	"Damped Least-Squares",
+	"Cyclic Coordinate Descent",
+	"FABRIK"
+};
+
 // The shader program id
 GLuint Window::shaderProgram;
 
@@ -52,8 +109,37 @@ bool Window::initializeProgram() {
 
 bool Window::initializeObjects()
 {
-	// joint chain
-	chain = new Chain(6, glm::vec3(0, -3, 0));
+	// joint chain, from a rig file if there is one
+	if (rigPath) {
+		Skeleton rig;
+		if (!loadRigCached(rigPath, rig)) {
+			return false;
+		}
+		if (!rig.isChain()) {
+			std::cerr << "Rig " << rigPath << " is not a single chain" << std::endl;
+			return false;
+		}
+		chain = new Chain(rig, glm::vec3(0, -3, 0));
+	}
+	else {
+		chain = new Chain(6, glm::vec3(0, -3, 0));
+	}
+	// stop early when the target is moved out of reach; sampling the
+	// workspace of a large rig takes a while, so the map is built on a thread
+	// of its own from a copy of the skeleton and the chain solves without it
+	// until it is done
+	reachability = 0;
+	reachabilityAttached = false;
+	if (!replayPath) {
+		Skeleton skeleton = chain->getSkeleton();
+		reachabilityBuild = std::async(std::launch::async, [skeleton]() {
+			return new ReachabilityMap(skeleton);
+		});
+	}
+	// how the solves converge, printed on I
+	telemetry = new SolverTelemetry();
+	chain->setTelemetry(telemetry);
+	chainRenderer = new ChainRenderer(chain);
 	// target
 	target = new Cube(glm::vec3(0, 3, 0), glm::vec3(1, 0.95, 0.1),
 		glm::vec3(-0.1), glm::vec3(0.1));
@@ -61,14 +147,88 @@ bool Window::initializeObjects()
 	land = new Cube(glm::vec3(0, -3, 0), glm::vec3(0.5),
 		glm::vec3(-1, -0.05, -0.5), glm::vec3(1, 0.05, 0.5));
 
+	// play a recording back
+	replay = 0;
+	if (replayPath) {
+		replay = new Recording();
+		if (!replay->open(replayPath) || replay->getFrameCount() == 0
+				|| replay->getJointCount() != (int)chain->getJoints().size()) {
+			std::cerr << "Failed to open recording " << replayPath << std::endl;
+			return false;
+		}
+		replayStart = glfwGetTime();
+		replayFrame = 0;
+	}
+
+	// record the chain and the target
+	recorder = 0;
+	if (recordPath) {
+		recorder = new RecordingWriter();
+		if (!recorder->open(recordPath, (int)chain->getJoints().size())) {
+			std::cerr << "Failed to create recording " << recordPath << std::endl;
+			return false;
+		}
+		recordStart = glfwGetTime();
+		recordTime = -1;
+	}
+
+	// time the phases of every frame
+	profiler = 0;
+	if (profilePath) {
+		profiler = new FrameProfiler(phaseNames, PHASE_COUNT);
+		profiler->setEnabled(true);
+	}
+
+	// trace the solver and the draw calls
+	trace = 0;
+	if (tracePath) {
+		trace = new TraceWriter();
+		if (!trace->start(tracePath)) {
+			std::cerr << "Failed to create trace " << tracePath << std::endl;
+			return false;
+		}
+	}
+
+	// solve on a thread of its own, from here on it owns the chain
+	solver = chain->getSolver();
+	solverThread = 0;
+	if (solverTickRate > 0 && !replay) {
+		solverThread = new SolverThread(chain, target->getLocation(), solverTickRate);
+		solverThread->start();
+	}
+
 	return true;
 }
 
 void Window::cleanUp()
 {
+	// Stop the solver before the chain goes away, and before the trace it
+	// records to.
+	delete solverThread;
+	// wait for the reachability map, the thread may still be building it
+	if (reachabilityBuild.valid()) {
+		reachability = reachabilityBuild.get();
+	}
+	if (trace) {
+		trace->stop();
+		if (trace->getDropped() > 0) {
+			std::cerr << trace->getDropped() << " trace events dropped" << std::endl;
+		}
+		delete trace;
+	}
+	delete recorder;
+	delete replay;
+	if (profiler) {
+		writeProfile();
+		delete profiler;
+	}
+
 	// Deallcoate the objects.
 	delete land;
+	delete chainRenderer;
 	delete chain;
+	delete reachability;
+	delete telemetry;
 	delete target;
 
 	// Delete the shader program.
@@ -164,32 +324,85 @@ void Window::resizeCallback(GLFWwindow* window, int width, int height)
 void Window::idleCallback()
 {
 	// Perform any updates as necessary. 
-	Cam->Update();
+	{
+		ScopedPhase phase(profiler, PHASE_CAMERA);
+		Cam->Update();
+	}
+	{
+		ScopedPhase phase(profiler, PHASE_TARGET);
+		target->update();
+	}
 
-	// update chain and target
-	chain->update();
-	target->update();
+	attachReachability();
 
-	// if not paused, move chain toward the target
-	if (!pause) {
-            chain->moveToward(target->getLocation());
+	if (replay) {
+		// the recording drives the chain
+		ScopedPhase phase(profiler, PHASE_REPLAY);
+		playBack();
+	}
+	else if (!solverThread) {
+		// update chain, and if not paused, move it toward the target within
+		// the frame budget; otherwise the solver thread takes care of it
+		{
+			ScopedPhase phase(profiler, PHASE_CHAIN_UPDATE);
+			chain->update();
+		}
+		if (!pause) {
+			ScopedPhase phase(profiler, PHASE_SOLVE);
+			chain->solve(target->getLocation(), solveBudget);
+		}
+	}
+
+	if (recorder) {
+		ScopedPhase phase(profiler, PHASE_RECORD);
+		record();
 	}
 }
 
 void Window::displayCallback(GLFWwindow* window)
 {	
+	// a frame is this display and the idle callback after it
+	if (profiler) {
+		profiler->beginFrame();
+	}
+
 	// Clear the color and depth buffers.
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);	
+	{
+		ScopedPhase phase(profiler, PHASE_CLEAR);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);	
+	}
 
 	// Render the object.
-	land->draw(Cam->GetViewProjectMtx(), Window::shaderProgram);
-	chain->draw(Cam->GetViewProjectMtx(), Window::shaderProgram);
-	target->draw(Cam->GetViewProjectMtx(), Window::shaderProgram);
+	{
+		ScopedPhase phase(profiler, PHASE_DRAW_LAND);
+		land->draw(Cam->GetViewProjectMtx(), Window::shaderProgram);
+	}
+	{
+		ScopedPhase phase(profiler, PHASE_DRAW_CHAIN);
+		if (solverThread) {
+			// latest pose the solver thread published
+			chainRenderer->draw(Cam->GetViewProjectMtx(), solverThread->getFrame().worlds,
+				Window::shaderProgram);
+		}
+		else {
+			chainRenderer->draw(Cam->GetViewProjectMtx(), Window::shaderProgram);
+		}
+	}
+	{
+		ScopedPhase phase(profiler, PHASE_DRAW_TARGET);
+		target->draw(Cam->GetViewProjectMtx(), Window::shaderProgram);
+	}
 
 	// Gets events, including input such as keyboard and mouse or window resizing.
-	glfwPollEvents();
+	{
+		ScopedPhase phase(profiler, PHASE_POLL_EVENTS);
+		glfwPollEvents();
+	}
 	// Swap buffers.
-	glfwSwapBuffers(window);
+	{
+		ScopedPhase phase(profiler, PHASE_SWAP_BUFFERS);
+		glfwSwapBuffers(window);
+	}
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -201,6 +414,93 @@ void Window::resetCamera()
 	Cam->SetAspect(float(Window::width) / float(Window::height));
 }
 
+// helper to write the current frame to the recording
+void Window::record()
+{
+	double time = glfwGetTime() - recordStart;
+	if (time - recordTime < 1 / RECORD_RATE) {
+		return;
+	}
+	recordTime = time;
+
+	if (solverThread) {
+		const SolverFrame& frame = solverThread->getFrame();
+		recorder->write((float)time, frame.target, &frame.poses[0]);
+	}
+	else {
+		recorder->write((float)time, target->getLocation(), &chain->getSkeleton().poses[0]);
+	}
+}
+
+// helper to show the frame of the recording for the current time, looping
+// at the end; the poses are read straight from the mapped file
+void Window::playBack()
+{
+	double time = glfwGetTime() - replayStart;
+	if (time > replay->getTime(replay->getFrameCount() - 1)) {
+		replayStart = glfwGetTime();
+		replayFrame = 0;
+		time = 0;
+	}
+	replayFrame = replay->findFrame((float)time, replayFrame);
+
+	const glm::vec3* poses = replay->getPoses(replayFrame);
+	Skeleton& skeleton = chain->getSkeleton();
+	for (int i = 0; i < skeleton.size(); ++i) {
+		skeleton.setPose(i, poses[i]);
+	}
+	chain->update();
+	target->translate(replay->getTarget(replayFrame) - target->getLocation());
+}
+
+// helper to write the frame phase timings to the profile
+void Window::writeProfile()
+{
+	if (profiler->writeCsv(profilePath)) {
+		std::cerr << "Frame timings written to " << profilePath << std::endl;
+	}
+	else {
+		std::cerr << "Failed to write frame timings to " << profilePath << std::endl;
+	}
+}
+
+// hand the reachability map to the solver once its thread has built it; if
+// the solver thread's queue is full, try again on the next frame
+void Window::attachReachability()
+{
+	if (reachabilityBuild.valid()) {
+		if (reachabilityBuild.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+			return;
+		}
+		reachability = reachabilityBuild.get();
+		reachabilityAttached = false;
+	}
+	if (!reachability || reachabilityAttached) {
+		return;
+	}
+	if (solverThread) {
+		reachabilityAttached = solverThread->setReachability(reachability);
+	}
+	else {
+		chain->setReachability(reachability);
+		reachabilityAttached = true;
+	}
+}
+
+// helper to move the target and pass it on to the solver thread
+void Window::moveTarget(glm::vec3 offset)
+{
+	target->translate(offset);
+	glm::vec3 loc = target->getLocation();
+	if (solverThread) {
+		solverThread->setTarget(loc);
+	}
+	std::cerr << "Target Location: " <<
+		loc.x << ", " <<
+		loc.y << ", " <<
+		loc.z << std::endl;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
 // callbacks - for Interaction 
@@ -209,7 +509,6 @@ void Window::keyCallback(GLFWwindow* window, int key, int scancode, int action,
 	// Check for a key press.
 	if (action == GLFW_PRESS || action == GLFW_REPEAT)
 	{
-		auto loc = glm::vec3(0);
 		switch (key) 
 		{
 		case GLFW_KEY_ESCAPE:
@@ -244,69 +543,67 @@ void Window::keyCallback(GLFWwindow* window, int key, int scancode, int action,
 			}
 			break;
 
-		// toggle pause
+		// toggle pause; with the solver thread's queue full the key is dropped,
+		// so the window never disagrees with the thread
 		case GLFW_KEY_SPACE:
-			pause = !pause;
+			if (!solverThread || solverThread->setPause(!pause)) {
+				pause = !pause;
+			}
+			break;
+
+		// print the convergence telemetry, safe while the solver thread runs
+		case GLFW_KEY_I:
+			telemetry->print(stderr);
+			break;
+
+		// write the frame timings
+		case GLFW_KEY_T:
+			if (profiler) {
+				writeProfile();
+			}
+			break;
+
+		// cycle through the solvers, dropped like pause if the queue is full
+		case GLFW_KEY_M:
+			if (solverThread
+					&& !solverThread->setSolver(SolverMode((solver + 1) % SOLVER_MODE_COUNT))) {
+				break;
+			}
+			solver = SolverMode((solver + 1) % SOLVER_MODE_COUNT);
+			if (!solverThread) {
+				chain->setSolver(solver);
+			}
+			std::cerr << "Solver: " << solverNames[solver] << std::endl;
 			break;
 
 		// move target negative z
 		case GLFW_KEY_W:
-			target->translate(glm::vec3(0, 0, -0.05));
-			loc = target->getLocation();
-			std::cerr << "Target Location: " <<
-				loc.x << ", " <<
-				loc.y << ", " <<
-				loc.z << std::endl;
+			moveTarget(glm::vec3(0, 0, -0.05));
 			break;
 
 		// move target positive z
 		case GLFW_KEY_S:
-			target->translate(glm::vec3(0, 0, 0.05));
-			loc = target->getLocation();
-			std::cerr << "Target Location: " <<
-				loc.x << ", " <<
-				loc.y << ", " <<
-				loc.z << std::endl;
+			moveTarget(glm::vec3(0, 0, 0.05));
 			break;
 
 		// move target negative x
 		case GLFW_KEY_A:
-			target->translate(glm::vec3(-0.05, 0, 0));
-			loc = target->getLocation();
-			std::cerr << "Target Location: " <<
-				loc.x << ", " <<
-				loc.y << ", " <<
-				loc.z << std::endl;
+			moveTarget(glm::vec3(-0.05, 0, 0));
 			break;
 
 		// move target positive x
 		case GLFW_KEY_D:
-			target->translate(glm::vec3(0.05, 0, 0));
-			loc = target->getLocation();
-			std::cerr << "Target Location: " <<
-				loc.x << ", " <<
-				loc.y << ", " <<
-				loc.z << std::endl;
+			moveTarget(glm::vec3(0.05, 0, 0));
 			break;
 
 		// move target positive y
 		case GLFW_KEY_LEFT_SHIFT:
-			target->translate(glm::vec3(0, 0.05, 0));
-			loc = target->getLocation();
-			std::cerr << "Target Location: " <<
-				loc.x << ", " <<
-				loc.y << ", " <<
-				loc.z << std::endl;
+			moveTarget(glm::vec3(0, 0.05, 0));
 			break;
 
 		// move target negative y
 		case GLFW_KEY_LEFT_CONTROL:
-			target->translate(glm::vec3(0, -0.05, 0));
-			loc = target->getLocation();
-			std::cerr << "Target Location: " <<
-				loc.x << ", " <<
-				loc.y << ", " <<
-				loc.z << std::endl;
+			moveTarget(glm::vec3(0, -0.05, 0));
 			break;
 
 		default:
@@ -1,11 +1,18 @@
 #ifndef _WINDOW_H_
 #define _WINDOW_H_
 
+#include <future>
 #include "main.h"
 #include "Cube.h"
 #include "shader.h"
 #include "Camera.h"
 #include "Chain.h"
+#include "ChainRenderer.h"
+#include "SolverThread.h"
+#include "Recording.h"
+#include "Rig.h"
+#include "FrameProfiler.h"
+#include "TraceWriter.h"
 
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -16,6 +23,20 @@ private:
 	static bool pause;
 	static bool wireMode;
 	static bool cullingMode;
+	static long long solveBudget;
+	static SolverMode solver;
+
+	// recording and playback state, times in seconds
+	static double recordStart;
+	static double recordTime;
+	static double replayStart;
+	static int replayFrame;
+
+	static void moveTarget(glm::vec3 offset);
+	static void record();
+	static void playBack();
+	static void writeProfile();
+	static void attachReachability();
 
 public:
 	// Window Properties
@@ -23,9 +44,33 @@ public:
 	static int height;
 	static const char* windowTitle;
 
+	// Ticks per second of the solver thread, 0 solves in idleCallback instead
+	static int solverTickRate;
+	// Rig file of the chain, the built-in 6 joint arm if null
+	static const char* rigPath;
+	// Recording to write, and recording to play back instead of solving
+	static const char* recordPath;
+	static const char* replayPath;
+	// CSV file of the frame phase timings, written on T and at exit; no
+	// timings are taken if null
+	static const char* profilePath;
+	// Chrome trace of the solver and the draw calls, not traced if null
+	static const char* tracePath;
+
 	// Objects to render
 	static Cube* land;
 	static Chain* chain;
+	static ReachabilityMap* reachability;
+	// the reachability map being built, attached to the chain once done
+	static std::future<ReachabilityMap*> reachabilityBuild;
+	static bool reachabilityAttached;
+	static SolverTelemetry* telemetry;
+	static ChainRenderer* chainRenderer;
+	static SolverThread* solverThread;
+	static RecordingWriter* recorder;
+	static Recording* replay;
+	static FrameProfiler* profiler;
+	static TraceWriter* trace;
 	static Cube* target;
 
 	// Shader Program 
@@ -0,0 +1,284 @@
+////////////////////////////////////////
+// benchmark.cpp
+////////////////////////////////////////
+
+// Headless benchmark of the chain solvers.
+//
+//	benchmark [--joints N,N,...] [--samples N] [--seed N] [--iterations N]
+//		[--budget microseconds] [--reachability] [--format table|csv|json]
+//
+// For every chain length and solver mode, the benchmark solves the same
+// seeded random targets from the rest pose: reachable ones, the end of the
+// chain in a random pose within its limits, and unreachable ones, further
+// out than the chain can stretch. Each case reports solves per second, the
+// convergence rate, the iterations the converged solves took, the p50, p99
+// and p999 solve latency and the final residual. csv and json print one
+// record per case for scripts.
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include "Chain.h"
+#include "ReachabilityMap.h"
+
+////////////////////////////////////////////////////////////////////////////////
+
+static const char* solverFlags[SOLVER_MODE_COUNT] = {"jt", "dls", "ccd", "fabrik"};
+
+struct Options
+{
+	std::vector<int> jointCounts;
+	int samples;
+	unsigned int seed;
+	int maxIterations;
+	long long budget;
+	bool reachability;
+	std::string format;
+};
+
+struct Case
+{
+	int joints;
+	const char* solver;
+	const char* targets;
+	int samples;
+	double solvesPerSecond;
+	double converged;		// fraction of the solves
+	double iterations;		// mean over converged solves
+	double p50, p99, p999;	// latency in microseconds
+	double residual;		// mean final residual
+	double maxResidual;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+static void printUsage() {
+	std::fprintf(stderr, "usage: benchmark [--joints N,N,...] [--samples N] [--seed N] "
+		"[--iterations N] [--budget microseconds] [--reachability] [--format table|csv|json]\n");
+}
+
+static bool parseOptions(int argc, char* argv[], Options& options) {
+	options.jointCounts = {2, 6, 20, 100};
+	options.samples = 1000;
+	options.seed = 1;
+	options.maxIterations = 1000;
+	options.budget = LLONG_MAX;
+	options.reachability = false;
+	options.format = "table";
+
+	for (int i = 1; i < argc; ++i) {
+		std::string option = argv[i];
+		if (option == "--reachability") {
+			options.reachability = true;
+			continue;
+		}
+		if (i + 1 >= argc) {
+			return false;
+		}
+		const char* value = argv[++i];
+		if (option == "--joints") {
+			options.jointCounts.clear();
+			for (const char* next = value; *next; ) {
+				char* end;
+				options.jointCounts.push_back(glm::max((int)std::strtol(next, &end, 10), 1));
+				if (end == next) {
+					return false;
+				}
+				next = *end == ',' ? end + 1 : end;
+			}
+		}
+		else if (option == "--samples") {
+			options.samples = glm::max(std::atoi(value), 1);
+		}
+		else if (option == "--seed") {
+			options.seed = (unsigned int)std::strtoul(value, 0, 10);
+		}
+		else if (option == "--iterations") {
+			options.maxIterations = glm::max(std::atoi(value), 1);
+		}
+		else if (option == "--budget") {
+			options.budget = glm::max(std::atoll(value), 1LL);
+		}
+		else if (option == "--format") {
+			options.format = value;
+			if (options.format != "table" && options.format != "csv" && options.format != "json") {
+				return false;
+			}
+		}
+		else {
+			return false;
+		}
+	}
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// nearest rank percentile of sorted values
+static double getPercentile(const std::vector<double>& sorted, double percentile) {
+	size_t rank = (size_t)std::ceil(percentile / 100 * sorted.size());
+	return sorted[std::min(std::max(rank, (size_t)1), sorted.size()) - 1];
+}
+
+// Targets for a chain: ends of random poses within the limits, or points in
+// random directions beyond the longest the chain can stretch
+static std::vector<glm::vec3> makeTargets(Chain& chain, int count, bool reachable, unsigned int seed) {
+	Skeleton& skeleton = chain.getSkeleton();
+	std::vector<glm::vec3> rest = skeleton.poses;
+	std::mt19937 random(seed);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	std::normal_distribution<float> normal;
+
+	float reach = 0;
+	for (int i = 0; i < skeleton.size(); ++i) {
+		reach += glm::length(skeleton.offsets[i]) + skeleton.lengths[i];
+	}
+
+	std::vector<glm::vec3> targets(count);
+	for (int s = 0; s < count; ++s) {
+		if (reachable) {
+			for (int i = 0; i < skeleton.size(); ++i) {
+				// wide limits are sampled over a single turn
+				glm::vec3 lower = glm::max(skeleton.lowerLimits[i], glm::vec3(-3.14159265f));
+				glm::vec3 upper = glm::min(skeleton.upperLimits[i], glm::vec3(3.14159265f));
+				skeleton.setPose(i, lower + (upper - lower) * glm::vec3(unit(random), unit(random), unit(random)));
+			}
+			chain.update();
+			targets[s] = skeleton.getEndLocation(skeleton.size() - 1);
+		}
+		else {
+			glm::vec3 direction(normal(random), normal(random), normal(random));
+			targets[s] = chain.getModel().translation
+				+ glm::normalize(direction + glm::vec3(0, 1e-6f, 0)) * reach * (1.5f + unit(random));
+		}
+	}
+
+	for (int i = 0; i < skeleton.size(); ++i) {
+		skeleton.setPose(i, rest[i]);
+	}
+	chain.update();
+	return targets;
+}
+
+static Case runCase(Chain& chain, const std::vector<glm::vec3>& targets, const Options& options) {
+	Skeleton& skeleton = chain.getSkeleton();
+	std::vector<glm::vec3> rest = skeleton.poses;
+	std::vector<double> latencies(targets.size());
+	Case result = {};
+	double total = 0;
+	long long iterations = 0;
+	int converged = 0;
+
+	for (size_t s = 0; s < targets.size(); ++s) {
+		// every solve starts from the rest pose
+		for (int i = 0; i < skeleton.size(); ++i) {
+			skeleton.setPose(i, rest[i]);
+		}
+
+		auto start = std::chrono::steady_clock::now();
+		SolveResult solve = chain.solve(targets[s], options.budget, options.maxIterations);
+		latencies[s] = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+		total += latencies[s];
+		if (solve.converged) {
+			++converged;
+			iterations += solve.iterations;
+		}
+		result.residual += solve.residual;
+		result.maxResidual = glm::max(result.maxResidual, (double)solve.residual);
+	}
+
+	std::sort(latencies.begin(), latencies.end());
+	result.samples = (int)targets.size();
+	result.solvesPerSecond = targets.size() / glm::max(total * 1e-6, 1e-12);
+	result.converged = (double)converged / targets.size();
+	result.iterations = converged > 0 ? (double)iterations / converged : 0;
+	result.p50 = getPercentile(latencies, 50);
+	result.p99 = getPercentile(latencies, 99);
+	result.p999 = getPercentile(latencies, 99.9);
+	result.residual /= targets.size();
+	return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+static void printCase(const Case& c, const std::string& format, bool first) {
+	if (format == "csv") {
+		if (first) {
+			std::printf("joints,solver,targets,samples,solves_per_second,converged,iterations,"
+				"p50_us,p99_us,p999_us,residual,max_residual\n");
+		}
+		std::printf("%d,%s,%s,%d,%.1f,%.4f,%.2f,%.3f,%.3f,%.3f,%.6f,%.6f\n", c.joints, c.solver,
+			c.targets, c.samples, c.solvesPerSecond, c.converged, c.iterations, c.p50, c.p99,
+			c.p999, c.residual, c.maxResidual);
+	}
+	else if (format == "json") {
+		std::printf("%s\n  {\"joints\": %d, \"solver\": \"%s\", \"targets\": \"%s\", \"samples\": %d, "
+			"\"solves_per_second\": %.1f, \"converged\": %.4f, \"iterations\": %.2f, "
+			"\"p50_us\": %.3f, \"p99_us\": %.3f, \"p999_us\": %.3f, \"residual\": %.6f, "
+			"\"max_residual\": %.6f}", first ? "[" : ",", c.joints, c.solver, c.targets, c.samples,
+			c.solvesPerSecond, c.converged, c.iterations, c.p50, c.p99, c.p999, c.residual, c.maxResidual);
+	}
+	else {
+		if (first) {
+			std::printf("%6s %-7s %-12s %12s %9s %10s %10s %10s %10s %10s\n", "joints", "solver",
+				"targets", "solves/s", "converged", "iterations", "p50 us", "p99 us", "p999 us", "residual");
+		}
+		std::printf("%6d %-7s %-12s %12.0f %8.1f%% %10.1f %10.2f %10.2f %10.2f %10.4f\n", c.joints,
+			c.solver, c.targets, c.solvesPerSecond, 100 * c.converged, c.iterations, c.p50, c.p99,
+			c.p999, c.residual);
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char* argv[])
+{
+	Options options;
+	if (!parseOptions(argc, argv, options)) {
+		printUsage();
+		return EXIT_FAILURE;
+	}
+
+	bool first = true;
+	for (int joints : options.jointCounts) {
+		// the same arm as the demo, with the given number of joints
+		Chain chain(joints, glm::vec3(0, -3, 0));
+		ReachabilityMap* reachability = 0;
+		if (options.reachability) {
+			reachability = new ReachabilityMap(chain.getSkeleton());
+			chain.setReachability(reachability);
+		}
+
+		for (int reachable = 1; reachable >= 0; --reachable) {
+			// the same targets for every solver
+			std::vector<glm::vec3> targets = makeTargets(chain, options.samples, reachable != 0,
+				options.seed + joints);
+			for (int solver = 0; solver < SOLVER_MODE_COUNT; ++solver) {
+				chain.setSolver(SolverMode(solver));
+				Case c = runCase(chain, targets, options);
+				c.joints = joints;
+				c.solver = solverFlags[solver];
+				c.targets = reachable ? "reachable" : "unreachable";
+				printCase(c, options.format, first);
+				first = false;
+				std::fflush(stdout);
+			}
+		}
+
+		chain.setReachability(0);
+		delete reachability;
+	}
+	if (options.format == "json") {
+		std::printf(first ? "[]\n" : "\n]\n");
+	}
+	return EXIT_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
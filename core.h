@@ -7,9 +7,6 @@
 #include <GL/glew.h>
 #endif
 
-#include <glm/glm.hpp>
-#include <glm/gtx/transform.hpp>
-#include <vector>
-#include <ctype.h>
+#include "ikcore.h"
 
 #endif
\ No newline at end of file
@@ -0,0 +1,12 @@
+#ifndef _IKCORE_H_
+#define _IKCORE_H_
+
+// Headless subset of core.h. The kinematics and solver code only depends on
+// GLM, so it can be built and run without an OpenGL context.
+
+#include <glm/glm.hpp>
+#include <glm/gtx/transform.hpp>
+#include <vector>
+#include <ctype.h>
+
+#endif
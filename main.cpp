@@ -54,8 +54,35 @@ void print_versions()
 
 ////////////////////////////////////////////////////////////////////////////////
 
-int main(void)
+int main(int argc, char* argv[])
 {
+	// --solver-rate <ticks per second> runs the solver on its own thread,
+	// --record <file> records the session and --replay <file> plays one back,
+	// --rig <file> loads the chain from a rig file, --profile <file> times
+	// the phases of each frame and writes them to a CSV file, --trace <file>
+	// writes a Chrome trace of the solver steps and the draw calls
+	for (int i = 1; i + 1 < argc; ++i) {
+		std::string option = argv[i];
+		if (option == "--solver-rate") {
+			Window::solverTickRate = atoi(argv[++i]);
+		}
+		else if (option == "--record") {
+			Window::recordPath = argv[++i];
+		}
+		else if (option == "--replay") {
+			Window::replayPath = argv[++i];
+		}
+		else if (option == "--rig") {
+			Window::rigPath = argv[++i];
+		}
+		else if (option == "--profile") {
+			Window::profilePath = argv[++i];
+		}
+		else if (option == "--trace") {
+			Window::tracePath = argv[++i];
+		}
+	}
+
 	// Create the GLFW window.
 	GLFWwindow* window = Window::createWindow(800, 600);
 	if (!window) exit(EXIT_FAILURE);
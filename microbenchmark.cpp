@@ -0,0 +1,266 @@
+////////////////////////////////////////
+// microbenchmark.cpp
+////////////////////////////////////////
+
+// Microbenchmarks of the per-joint kernels and of one solver step.
+//
+//	microbenchmark [--joints N,N,...] [--time milliseconds] [--format table|csv]
+//
+// Each kernel runs over the demo arm at every chain length for about the given
+// time: Joint::updateJoint, jacobianX/Y/Z and incrementPose once per joint in
+// a sweep down the chain, and Chain::moveToward with every solver mode, from
+// the rest pose toward the same reachable target each call. The report gives
+// the time per call, the time per joint and the heap allocations per call,
+// counted by the operator new below.
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include "Chain.h"
+
+////////////////////////////////////////////////////////////////////////////////
+
+// every allocation of the process goes through here
+static std::atomic<long long> allocationCount(0);
+
+void* operator new(size_t size) {
+	++allocationCount;
+	void* memory = std::malloc(size ? size : 1);
+	if (!memory) {
+		throw std::bad_alloc();
+	}
+	return memory;
+}
+
+void operator delete(void* memory) noexcept {
+	std::free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept {
+	std::free(memory);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+static const char* solverNames[SOLVER_MODE_COUNT] = {"jt", "dls", "ccd", "fabrik"};
+
+struct Options
+{
+	std::vector<int> jointCounts;
+	double time;		// seconds per kernel and length
+	std::string format;
+};
+
+struct Measure
+{
+	long long calls;
+	double seconds;
+	long long allocations;
+};
+
+// keeps the results of the kernels alive
+static volatile float sink;
+
+////////////////////////////////////////////////////////////////////////////////
+
+static void printUsage() {
+	std::fprintf(stderr, "usage: microbenchmark [--joints N,N,...] [--time milliseconds] "
+		"[--format table|csv]\n");
+}
+
+static bool parseOptions(int argc, char* argv[], Options& options) {
+	options.jointCounts = {2, 5, 10, 20, 50, 100, 200, 500, 1000};
+	options.time = 0.2;
+	options.format = "table";
+
+	for (int i = 1; i < argc; i += 2) {
+		if (i + 1 >= argc) {
+			return false;
+		}
+		std::string option = argv[i];
+		const char* value = argv[i + 1];
+		if (option == "--joints") {
+			options.jointCounts.clear();
+			for (const char* next = value; *next; ) {
+				char* end;
+				options.jointCounts.push_back(glm::max((int)std::strtol(next, &end, 10), 1));
+				if (end == next) {
+					return false;
+				}
+				next = *end == ',' ? end + 1 : end;
+			}
+		}
+		else if (option == "--time") {
+			options.time = glm::max(std::atof(value), 1.0) * 1e-3;
+		}
+		else if (option == "--format") {
+			options.format = value;
+			if (options.format != "table" && options.format != "csv") {
+				return false;
+			}
+		}
+		else {
+			return false;
+		}
+	}
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Call sweep, which runs a kernel and returns the number of calls it made,
+// until the time is up. Sweeps are timed in batches so the clock does not
+// dominate the short ones; reset runs between batches, outside of the time.
+template <class Sweep, class Reset>
+static Measure measure(double time, Sweep sweep, Reset reset) {
+	// warm up the caches and the scratch buffers the kernel grows
+	reset();
+	sweep();
+
+	Measure result = {0, 0, 0};
+	int batch = 1;
+	while (result.seconds < time) {
+		reset();
+		long long allocations = allocationCount;
+		auto start = std::chrono::steady_clock::now();
+		long long calls = 0;
+		for (int i = 0; i < batch; ++i) {
+			calls += sweep();
+		}
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		result.allocations += allocationCount - allocations;
+		result.calls += calls;
+		result.seconds += seconds;
+		// aim for batches of about a millisecond
+		if (seconds < 1e-3 && batch < (1 << 20)) {
+			batch *= 2;
+		}
+	}
+	return result;
+}
+
+static void printMeasure(const char* kernel, int joints, int jointsPerCall, const Measure& m,
+	const std::string& format, bool first) {
+	double nsPerCall = m.seconds * 1e9 / m.calls;
+	double nsPerJoint = nsPerCall / jointsPerCall;
+	double allocationsPerCall = (double)m.allocations / m.calls;
+	if (format == "csv") {
+		if (first) {
+			std::printf("kernel,joints,calls,ns_per_call,ns_per_joint,allocations_per_call\n");
+		}
+		std::printf("%s,%d,%lld,%.3f,%.3f,%.4f\n", kernel, joints, m.calls, nsPerCall, nsPerJoint,
+			allocationsPerCall);
+	}
+	else {
+		if (first) {
+			std::printf("%-18s %6s %12s %12s %10s %12s\n", "kernel", "joints", "calls", "ns/call",
+				"ns/joint", "allocs/call");
+		}
+		std::printf("%-18s %6d %12lld %12.1f %10.2f %12.4f\n", kernel, joints, m.calls, nsPerCall,
+			nsPerJoint, allocationsPerCall);
+	}
+	std::fflush(stdout);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char* argv[])
+{
+	Options options;
+	if (!parseOptions(argc, argv, options)) {
+		printUsage();
+		return EXIT_FAILURE;
+	}
+
+	bool first = true;
+	for (int count : options.jointCounts) {
+		// the same arm as the demo, with the given number of joints
+		Chain chain(count, glm::vec3(0, -3, 0));
+		Skeleton& skeleton = chain.getSkeleton();
+		const std::vector<Joint*>& joints = chain.getJoints();
+		std::vector<glm::vec3> rest = skeleton.poses;
+		chain.update();
+
+		auto restPose = [&]() {
+			for (int i = 0; i < count; ++i) {
+				skeleton.setPose(i, rest[i]);
+			}
+			chain.update();
+		};
+		auto noReset = []() {};
+
+		// a target the chain reaches, the end of a bent pose
+		for (int i = 0; i < count; ++i) {
+			skeleton.setPose(i, rest[i] + glm::vec3(0.3f, 0.2f, 0.4f));
+		}
+		chain.update();
+		glm::vec3 target = skeleton.getEndLocation(count - 1);
+		restPose();
+
+		// forward kinematics, each joint from its parent's world transform
+		Measure m = measure(options.time, [&]() {
+			const Transform& model = chain.getModel();
+			for (int i = 0; i < count; ++i) {
+				int parent = skeleton.parents[i];
+				joints[i]->updateJoint(parent < 0 ? model : skeleton.worlds[parent]);
+			}
+			return (long long)count;
+		}, noReset);
+		printMeasure("updateJoint", count, 1, m, options.format, first);
+		first = false;
+
+		const char* jacobianNames[3] = {"jacobianX", "jacobianY", "jacobianZ"};
+		for (int axis = 0; axis < 3; ++axis) {
+			m = measure(options.time, [&]() {
+				glm::vec3 sum(0);
+				for (int i = 0; i < count; ++i) {
+					sum += axis == 0 ? joints[i]->jacobianX(target)
+						: axis == 1 ? joints[i]->jacobianY(target) : joints[i]->jacobianZ(target);
+				}
+				sink = sum.x + sum.y + sum.z;
+				return (long long)count;
+			}, noReset);
+			printMeasure(jacobianNames[axis], count, 1, m, options.format, false);
+		}
+
+		// alternate the sign so the pose swings back instead of running into
+		// the limits, where it would stop changing
+		float sign = 1;
+		m = measure(options.time, [&]() {
+			glm::vec3 delta = sign * glm::vec3(0.001f);
+			for (int i = 0; i < count; ++i) {
+				joints[i]->incrementPose(delta);
+			}
+			sign = -sign;
+			return (long long)count;
+		}, restPose);
+		printMeasure("incrementPose", count, 1, m, options.format, false);
+
+		// one step from the rest pose each call, timed alone so the reset is
+		// left out; a step is long enough for the clock to be fine
+		for (int solver = 0; solver < SOLVER_MODE_COUNT; ++solver) {
+			chain.setSolver(SolverMode(solver));
+			restPose();
+			chain.moveToward(target);
+			m = Measure{0, 0, 0};
+			while (m.seconds < options.time) {
+				restPose();
+				long long allocations = allocationCount;
+				auto start = std::chrono::steady_clock::now();
+				chain.moveToward(target);
+				m.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+				m.allocations += allocationCount - allocations;
+				++m.calls;
+			}
+			std::string kernel = std::string("moveToward ") + solverNames[solver];
+			printMeasure(kernel.c_str(), count, count, m, options.format, false);
+		}
+		restPose();
+	}
+	return EXIT_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
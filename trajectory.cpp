@@ -0,0 +1,170 @@
+////////////////////////////////////////
+// trajectory.cpp
+////////////////////////////////////////
+
+// Headless tool solving a recorded target trajectory offline.
+//
+//	trajectory <targets> <poses> [--joints N | --rig file]
+//		[--solver jt|dls|ccd|fabrik] [--iterations N] [--budget microseconds]
+//
+// The targets file is a plain stream of samples, 3 32-bit floats x, y, z per
+// sample in the chain's model space, with the root of the chain at the
+// origin. For every sample the poses file gets the x, y, z angles of each
+// joint in order, also as 32-bit floats. Each sample is solved starting from
+// the pose the previous one was solved to, and both files go through fixed
+// size blocks, so memory use does not depend on the length of the trajectory.
+// A targets file ending in a partial sample is reported as truncated, after
+// the poses of the whole samples are written.
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include "Chain.h"
+#include "Rig.h"
+
+////////////////////////////////////////////////////////////////////////////////
+
+// samples read and written at a time
+static const int BLOCK_SIZE = 4096;
+
+static const char* solverFlags[SOLVER_MODE_COUNT] = {"jt", "dls", "ccd", "fabrik"};
+
+static void printUsage() {
+	std::fprintf(stderr, "usage: trajectory <targets> <poses> [--joints N | --rig file] "
+		"[--solver jt|dls|ccd|fabrik] [--iterations N] [--budget microseconds]\n");
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char* argv[])
+{
+	if (argc < 3) {
+		printUsage();
+		return EXIT_FAILURE;
+	}
+
+	// options
+	int jointCount = 6;
+	const char* rig = 0;
+	int solver = JACOBIAN_TRANSPOSE;
+	int maxIterations = 1000;
+	long long budget = LLONG_MAX;
+	for (int i = 3; i < argc; i += 2) {
+		// every option takes a value
+		if (i + 1 >= argc) {
+			printUsage();
+			return EXIT_FAILURE;
+		}
+		std::string option = argv[i];
+		if (option == "--joints") {
+			jointCount = glm::max(std::atoi(argv[i + 1]), 1);
+		}
+		else if (option == "--rig") {
+			rig = argv[i + 1];
+		}
+		else if (option == "--solver") {
+			for (solver = 0; solver < SOLVER_MODE_COUNT; ++solver) {
+				if (std::strcmp(argv[i + 1], solverFlags[solver]) == 0) {
+					break;
+				}
+			}
+			if (solver == SOLVER_MODE_COUNT) {
+				printUsage();
+				return EXIT_FAILURE;
+			}
+		}
+		else if (option == "--iterations") {
+			maxIterations = glm::max(std::atoi(argv[i + 1]), 1);
+		}
+		else if (option == "--budget") {
+			budget = glm::max(std::atoll(argv[i + 1]), 1LL);
+		}
+		else {
+			printUsage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	// the same arm as the demo, or the one of the rig file
+	Skeleton skeleton;
+	if (rig && (!loadRigCached(rig, skeleton) || !skeleton.isChain())) {
+		std::fprintf(stderr, "trajectory: '%s' is not a single chain rig\n", rig);
+		return EXIT_FAILURE;
+	}
+	std::unique_ptr<Chain> chain(rig ? new Chain(skeleton, glm::vec3(0, -3, 0))
+		: new Chain(jointCount, glm::vec3(0, -3, 0)));
+	chain->setSolver(SolverMode(solver));
+	jointCount = (int)chain->getJoints().size();
+
+	FILE* input = std::fopen(argv[1], "rb");
+	if (!input) {
+		std::fprintf(stderr, "trajectory: can not open '%s'\n", argv[1]);
+		return EXIT_FAILURE;
+	}
+	FILE* output = std::fopen(argv[2], "wb");
+	if (!output) {
+		std::fprintf(stderr, "trajectory: can not create '%s'\n", argv[2]);
+		std::fclose(input);
+		return EXIT_FAILURE;
+	}
+
+	std::vector<glm::vec3> targets(BLOCK_SIZE);
+	std::vector<glm::vec3> poses((size_t)BLOCK_SIZE * jointCount);
+	long long samples = 0, converged = 0, iterations = 0;
+	auto start = std::chrono::steady_clock::now();
+
+	// read bytes rather than samples, so a partial sample at the end shows up;
+	// fread only comes up short at the end of the file or on an error
+	size_t bytes, partial = 0;
+	while ((bytes = std::fread(&targets[0], 1, sizeof(glm::vec3) * BLOCK_SIZE, input)) > 0) {
+		size_t count = bytes / sizeof(glm::vec3);
+		partial = bytes % sizeof(glm::vec3);
+		for (size_t s = 0; s < count; ++s) {
+			// warm start, the chain is still at the previous sample's pose; the
+			// solver takes world space targets
+			glm::vec3 target = chain->getModel().transformPoint(targets[s]);
+			SolveResult result = chain->solve(target, budget, maxIterations);
+			converged += result.converged;
+			iterations += result.iterations;
+
+			const std::vector<glm::vec3>& pose = chain->getSkeleton().poses;
+			std::copy(pose.begin(), pose.end(), poses.begin() + s * jointCount);
+		}
+		if (std::fwrite(&poses[0], sizeof(glm::vec3) * jointCount, count, output) != count) {
+			std::fprintf(stderr, "trajectory: can not write '%s'\n", argv[2]);
+			std::fclose(input);
+			std::fclose(output);
+			return EXIT_FAILURE;
+		}
+		samples += count;
+	}
+
+	bool readError = std::ferror(input) != 0;
+	std::fclose(input);
+	if (std::fclose(output) != 0) {
+		std::fprintf(stderr, "trajectory: can not write '%s'\n", argv[2]);
+		return EXIT_FAILURE;
+	}
+	if (readError) {
+		std::fprintf(stderr, "trajectory: can not read '%s'\n", argv[1]);
+		return EXIT_FAILURE;
+	}
+	if (partial > 0) {
+		std::fprintf(stderr, "trajectory: '%s' is truncated, %lld samples solved and %d "
+			"bytes of a partial one left over\n", argv[1], samples, (int)partial);
+		return EXIT_FAILURE;
+	}
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::fprintf(stderr, "%lld samples in %.3f s, %.0f samples/s, %.1f%% converged, "
+		"%.2f iterations per sample\n", samples, seconds, samples / glm::max(seconds, 1e-9),
+		100.0 * converged / glm::max(samples, 1LL), (double)iterations / glm::max(samples, 1LL));
+	return EXIT_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////